@@ -7,6 +7,7 @@
 #include <cstdint>
 #include <iostream>
 #include <limits>
+#include <utility>
 
 
 /**
@@ -92,6 +93,21 @@ public:
         data.emplace_back(value);
     }
 
+    /**
+     * @brief Adds a new interval, moving the associated data into the data structure
+     */
+    void add(S start, S end, T&& value) {
+        if (startSorted && !starts.empty()) {
+            startSorted = (start < starts.back()) ? false : true;
+            if (startSorted && start == starts.back() && end > ends.back()) {
+                endSorted = false;
+            }
+        }
+        starts.push_back(start);
+        ends.push_back(end);
+        data.emplace_back(std::move(value));
+    }
+
     /**
      * @brief Indexes the intervals.
      *
@@ -261,12 +277,21 @@ public:
 
     static constexpr auto findValues = &SuperIntervals::findOverlaps;
 
-    void findIndexes(const S start, const S end, std::vector<size_t>& found) {
+    // Const and leaves idx alone, so that several threads can search one index
+    void findIndexes(const S start, const S end, std::vector<size_t>& found) const {
         if (starts.empty()) {
             return;
         }
-        upperBound(end);
-        size_t i = idx;
+        size_t length = starts.size();
+        size_t i = 0;
+        while (length > 1) {
+            size_t half = length / 2;
+            i += (starts[i + half] <= end) * (length - half);
+            length = half;
+        }
+        if (i > 0 && starts[i] > end) {
+            --i;
+        }
         while (i > 0) {
             if (start <= ends[i]) {
                 found.push_back(i);
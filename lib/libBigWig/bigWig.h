@@ -475,6 +475,29 @@ double *bwStats(bigWigFile_t *fp, const char *chrom, uint32_t start, uint32_t en
 */
 double *bwStatsFromFull(bigWigFile_t *fp, const char *chrom, uint32_t start, uint32_t end, uint32_t nBins, enum bwStatsType type);
 
+/*!
+ * @brief Chooses the zoom level to read for a given resolution
+ * @param fp A valid bigWigFile_t pointer.
+ * @param basesPerBin The number of bases that will be summarised by one value, e.g. bases per pixel.
+ * @return The index of the coarsest zoom level whose reduction is at most basesPerBin, or -1 if the full resolution data should be read instead.
+ * @see bwGetZoomIntervals
+ */
+int bwGetZoomLevel(const bigWigFile_t *fp, uint32_t basesPerBin);
+
+/*!
+ * @brief Return the summary records of one zoom level that overlap an interval
+ * Unlike `bwStats()`, the records are returned as they are stored, one per reduced interval, with the mean of each as its value. Records without data are skipped.
+ * @param fp A valid bigWigFile_t pointer.
+ * @param chrom A valid chromosome name.
+ * @param start The start position of the interval. This is 0-based half open, so 0 is the first base.
+ * @param end The end position of the interval. Again, this is 0-based half open, so 100 will include the 100th base...which is at position 99.
+ * @param zoomLevel A zoom level index, as returned by `bwGetZoomLevel()`.
+ * @return NULL on error, otherwise a `bwOverlappingIntervals_t *` with start, end and value set, ordered by start.
+ * @see bwGetZoomLevel
+ * @see bwDestroyOverlappingIntervals
+ */
+bwOverlappingIntervals_t *bwGetZoomIntervals(bigWigFile_t *fp, const char *chrom, uint32_t start, uint32_t end, int zoomLevel);
+
 //Writer functions
 
 /*!
@@ -0,0 +1,121 @@
+#include "bigWig.h"
+#include "bwCommon.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+//On-disk zoom record, 32 bytes
+struct bwZoomRecord {
+    uint32_t tid;
+    uint32_t start;
+    uint32_t end;
+    uint32_t validCount;
+    float minVal;
+    float maxVal;
+    float sumData;
+    float sumSquares;
+};
+
+int bwGetZoomLevel(const bigWigFile_t *fp, uint32_t basesPerBin) {
+    int i, best = -1;
+    uint32_t bestLevel = 0;
+    if(!fp->hdr || !fp->hdr->zoomHdrs) return -1;
+    for(i=0; i<fp->hdr->nLevels; i++) {
+        if(fp->hdr->zoomHdrs->level[i] > basesPerBin) continue;
+        if(best < 0 || fp->hdr->zoomHdrs->level[i] > bestLevel) {
+            best = i;
+            bestLevel = fp->hdr->zoomHdrs->level[i];
+        }
+    }
+    return best;
+}
+
+static int pushZoomInterval(bwOverlappingIntervals_t *o, uint32_t *m, uint32_t start, uint32_t end, float value) {
+    if(o->l >= *m) {
+        *m = (*m) ? 2*(*m) : 1024;
+        uint32_t *s = realloc(o->start, *m * sizeof(uint32_t));
+        if(!s) return 0;
+        o->start = s;
+        uint32_t *e = realloc(o->end, *m * sizeof(uint32_t));
+        if(!e) return 0;
+        o->end = e;
+        float *v = realloc(o->value, *m * sizeof(float));
+        if(!v) return 0;
+        o->value = v;
+    }
+    o->start[o->l] = start;
+    o->end[o->l] = end;
+    o->value[o->l++] = value;
+    return 1;
+}
+
+bwOverlappingIntervals_t *bwGetZoomIntervals(bigWigFile_t *fp, const char *chrom, uint32_t start, uint32_t end, int zoomLevel) {
+    uint64_t i;
+    uint32_t j, n, m = 0;
+    int compressed = 0;
+    uLongf sz = 0, tmp;
+    void *buf = NULL, *compBuf = NULL;
+    struct bwZoomRecord r;
+    bwOverlapBlock_t *blocks = NULL;
+    bwOverlappingIntervals_t *output = NULL;
+    uint32_t tid = bwGetTid(fp, chrom);
+
+    if(tid == (uint32_t) -1) return NULL;
+    if(!fp->hdr->zoomHdrs || zoomLevel < 0 || zoomLevel >= fp->hdr->nLevels) return NULL;
+    if(!fp->hdr->zoomHdrs->idx[zoomLevel]) {
+        fp->hdr->zoomHdrs->idx[zoomLevel] = bwReadIndex(fp, fp->hdr->zoomHdrs->indexOffset[zoomLevel]);
+        if(!fp->hdr->zoomHdrs->idx[zoomLevel]) return NULL;
+    }
+    blocks = walkRTreeNodes(fp, fp->hdr->zoomHdrs->idx[zoomLevel]->root, tid, start, end);
+    output = calloc(1, sizeof(bwOverlappingIntervals_t));
+    if(!output) goto error;
+    if(!blocks || !blocks->n) {
+        destroyBWOverlapBlock(blocks);
+        return output;
+    }
+
+    if(fp->hdr->bufSize) {
+        compressed = 1;
+        buf = malloc(fp->hdr->bufSize);
+        if(!buf) goto error;
+    }
+    for(i=0; i<blocks->n; i++) {
+        if(bwSetPos(fp, blocks->offset[i])) goto error;
+        if(sz < blocks->size[i]) {
+            void *p = realloc(compBuf, blocks->size[i]);
+            if(!p) goto error;
+            compBuf = p;
+            sz = blocks->size[i];
+        }
+        if(bwRead(compBuf, blocks->size[i], 1, fp) != 1) goto error;
+        if(compressed) {
+            tmp = fp->hdr->bufSize;
+            if(uncompress(buf, &tmp, compBuf, blocks->size[i]) != Z_OK) goto error;
+        } else {
+            buf = compBuf;
+            tmp = blocks->size[i];
+        }
+
+        n = tmp / sizeof(struct bwZoomRecord);
+        for(j=0; j<n; j++) {
+            memcpy(&r, (char *) buf + j*sizeof(struct bwZoomRecord), sizeof(struct bwZoomRecord));
+            if(r.tid != tid || r.validCount == 0) continue;
+            if(r.end <= start || r.start >= end) continue;
+            if(!pushZoomInterval(output, &m, r.start, r.end, r.sumData / r.validCount)) goto error;
+        }
+    }
+
+    if(compressed && buf) free(buf);
+    if(compBuf) free(compBuf);
+    destroyBWOverlapBlock(blocks);
+    return output;
+
+error:
+    fprintf(stderr, "[bwGetZoomIntervals] Got an error\n");
+    if(output) bwDestroyOverlappingIntervals(output);
+    if(compressed && buf) free(buf);
+    if(compBuf) free(compBuf);
+    destroyBWOverlapBlock(blocks);
+    return NULL;
+}
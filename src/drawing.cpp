@@ -14,19 +14,25 @@
 #include <filesystem>
 #include <htslib/sam.h>
 
+#include "include/core/SkBitmap.h"
+#include "include/core/SkImage.h"
 #include "include/core/SkCanvas.h"
 #include "include/core/SkData.h"
 #include "include/core/SkImageInfo.h"
 #include "include/core/SkPaint.h"
 #include "include/core/SkPath.h"
+#include "include/core/SkPicture.h"
+#include "include/core/SkPictureRecorder.h"
 #include "include/core/SkTypeface.h"
 #include "include/core/SkTextBlob.h"
+#include "include/core/SkVertices.h"
 
 #include "BS_thread_pool.h"
 #include "ankerl_unordered_dense.h"
 #include "hts_funcs.h"
 #include "introns.h"
 #include "drawing.h"
+#include "glyph_atlas.h"
 #include "term_out.h"
 
 
@@ -42,12 +48,11 @@ namespace Drawing {
         TextItem() = default;
     };
 
-    struct TextItemIns{
-        sk_sp<SkTextBlob> text;
-        float x, y;
+    struct TextItemIns{  // insertion box, the length text is queued in a GlyphBatch
+        float x;
         float box_y, box_w;
-        TextItemIns(sk_sp<SkTextBlob> blob, float posX, float posY, float boxY, float boxW)
-            : text(std::move(blob)), x(posX), y(posY), box_y{boxY}, box_w{boxW} {}
+        TextItemIns(float posX, float boxY, float boxW)
+            : x(posX), box_y{boxY}, box_w{boxW} {}
         TextItemIns() = default;
     };
 
@@ -70,6 +75,7 @@ namespace Drawing {
         const float covY = covYh * 0.95;
         const float covY_f = covY * 0.3;
         float yOffsetAll;
+        GlyphBatch labels(canvas, fonts.overlay);
 
         for (auto &cl: collections) {
             if (cl.skipDrawingCoverage) {
@@ -299,15 +305,14 @@ namespace Drawing {
             }
 
             std::sprintf(indelChars, "%d", cMaxi);
-
-            sk_sp<SkTextBlob> blob = SkTextBlob::MakeFromString(indelChars, fonts.overlay);
-            canvas->drawTextBlob(blob, xOffset + 8 * monitorScale, covY_f + yOffsetAll + fonts.overlayHeight, theme.tcDel);
+            labels.add(indelChars, xOffset + 8 * monitorScale, covY_f + yOffsetAll + fonts.overlayHeight, theme.tcDel);
             path.reset();
             path.moveTo(xOffset, covY_f + yOffsetAll);
             path.lineTo(xOffset + 6 * monitorScale, covY_f + yOffsetAll);
             path.moveTo(xOffset, covY + yOffsetAll);
             path.lineTo(xOffset + 6 * monitorScale, covY + yOffsetAll);
             canvas->drawPath(path, theme.lcJoins);
+            labels.flush();  // the background of a data label below covers it
 
             // Draw data labels when alignments are not shown
             if (opts.data_labels && !opts.alignments && cl.regionIdx == 0) {
@@ -561,32 +566,30 @@ namespace Drawing {
             update_pass      // 15
     };
 
-    // Lookup table of pre-created text blobs
-    std::array<sk_sp<SkTextBlob>, 16> lookup_table_bam_textblobs;
-
-    void initializeTextBlobs(const Themes::Fonts &fonts) {
-        // Nibble to text
-        std::array<const char*, 16> lookup_table_bam_text = {
-                "",     // 0
-                "A",    // 1
-                "C",    // 2
-                "",     // 3
-                "G",    // 4
-                "",     // 5
-                "",     // 6
-                "",     // 7
-                "T",    // 8
-                "",     // 9
-                "",     // 10
-                "",     // 11
-                "",     // 12
-                "",     // 13
-                "",     // 14
-                "N"      // 15
-        };
-         for (int i = 0; i < 16; i++) {
-            lookup_table_bam_textblobs[i] = SkTextBlob::MakeFromString(
-                lookup_table_bam_text[i], fonts.overlay);
+    // Nibble to base letter, drawn from the glyph atlas. 0 means nothing to draw
+    constexpr std::array<char, 16> lookup_table_bam_char = {
+            0,      // 0
+            'A',    // 1
+            'C',    // 2
+            0,      // 3
+            'G',    // 4
+            0,      // 5
+            0,      // 6
+            0,      // 7
+            'T',    // 8
+            0,      // 9
+            0,      // 10
+            0,      // 11
+            0,      // 12
+            0,      // 13
+            0,      // 14
+            'N'     // 15
+    };
+
+    inline void addBaseLetter(GlyphBatch &letters, const uint8_t base, const float x, const float y, const SkPaint &paint) {
+        const char c = lookup_table_bam_char[base & 15];
+        if (c) {
+            letters.add(c, x, y, paint);
         }
     }
 
@@ -606,7 +609,8 @@ namespace Drawing {
                        const Segs::Align &align,
                        float width, float xScaling, float xOffset, float mmPosOffset, float yScaledOffset,
                        float pH, int l_qseq, std::vector<Segs::Mismatches> &mm_array,
-                       bool &collection_processed, bool charFits, float textOffsetX, float textOffsetY) {
+                       bool &collection_processed, bool charFits, float textOffsetX, float textOffsetY,
+                       GlyphBatch &letters) {
         if (!region->refSeq || align.blocks.empty() || mm_array.empty()) {
             collection_processed = true;
             return;
@@ -661,10 +665,10 @@ namespace Drawing {
                         lookup_table_mm[(unsigned char)bam_base](mm_array[ref_idx]);
                     }
                     if (charFits) {
-                        canvas->drawTextBlob(lookup_table_bam_textblobs[(int)bam_base],
-                                           p + precalculated_xOffset_mmPosOffset + text_x_offset,
-                                           yScaledOffset + text_y_offset,
-                                           theme.tcIns);
+                        addBaseLetter(letters, bam_base,
+                                      p + precalculated_xOffset_mmPosOffset + text_x_offset,
+                                      yScaledOffset + text_y_offset,
+                                      theme.tcIns);
                     }
                 }
                 ref_idx += 1;
@@ -800,7 +804,7 @@ namespace Drawing {
                   const Themes::Fonts &fonts,
                   const int regionBegin, const int Y, const int regionLen, const int starti, int const lastEndi,
                   const float regionPixels, const float xScaling, const float yScaling, const float xOffset, const float yOffset,
-                  std::vector<TextItem> &text, const bool indelTextFits, const float halfPolygonHeight) {
+                  GlyphBatch &text, const bool indelTextFits, const float halfPolygonHeight, const float monitorScale) {
         const int isize = starti - lastEndi;
         const int lastEnd = lastEndi - regionBegin;
         const int startRelative = starti - regionBegin;
@@ -821,11 +825,7 @@ namespace Drawing {
                 const float textBegin = textCenter - (textWidth * 0.5f);
                 const float textEnd = textBegin + textWidth;
                 const float textYPosition = yh + (fonts.overlayHeight * 0.5f);
-                text.emplace_back(
-                    SkTextBlob::MakeFromString(indelChars, fonts.overlay),
-                    textBegin + xOffset,
-                    textYPosition
-                );
+                text.add(indelChars, textBegin + xOffset + (monitorScale * 0.5f), textYPosition, opts.theme.tcDel);
                 if (textBegin > delBegin) {
                     drawHLine(canvas, path, opts.theme.lcJoins, delBegin + xOffset, yh, textBegin + xOffset);
                     drawHLine(canvas, path, opts.theme.lcJoins, textEnd + xOffset, yh, delEnd + xOffset);
@@ -842,107 +842,135 @@ namespace Drawing {
         }
     }
 
-    void drawMods(SkCanvas *const canvas, SkRect &rect, const Themes::BaseTheme &theme, const Utils::Region *region,
+    inline int modTypeIndex(const char mod) {
+        switch (mod) {
+            case 'm':  // 5mC
+                return 0;
+            case 'h':  // 5hmC
+                return 1;
+            default:
+                return 2;
+        }
+    }
+
+    // Modification probability (0-255) binned to the 4 alpha levels of theme.ModPaints
+    inline int modQualBin(const uint8_t qual) {
+        return qual >> 6;
+    }
+
+    /*
+     * Base modifications are collected per (modification type, probability bin) while walking the
+     * collection, then drawn with one call per bucket. Dots are stored as points, blocks as two
+     * triangles each.
+     */
+    struct ModBatch {
+        std::array<std::array<std::vector<SkPoint>, 4>, 3> buckets;
+        bool as_dots{false};
+
+        void clear() {
+            for (auto &type : buckets) {
+                for (auto &bin : type) {
+                    bin.clear();
+                }
+            }
+        }
+
+        void addDot(const int type, const int bin, const float x, const float y) {
+            buckets[type][bin].push_back(SkPoint::Make(x, y));
+        }
+
+        void addRect(const int type, const int bin, const float x, const float y, const float w, const float h) {
+            std::vector<SkPoint> &v = buckets[type][bin];
+            const float r = x + w;
+            const float b = y + h;
+            v.push_back(SkPoint::Make(x, y));
+            v.push_back(SkPoint::Make(r, y));
+            v.push_back(SkPoint::Make(x, b));
+            v.push_back(SkPoint::Make(r, y));
+            v.push_back(SkPoint::Make(r, b));
+            v.push_back(SkPoint::Make(x, b));
+        }
+
+        void flush(SkCanvas *const canvas, const Themes::BaseTheme &theme) {
+            for (size_t type = 0; type < buckets.size(); ++type) {
+                for (size_t bin = 0; bin < 4; ++bin) {
+                    std::vector<SkPoint> &v = buckets[type][bin];
+                    if (v.empty()) {
+                        continue;
+                    }
+                    const SkPaint &paint = theme.ModPaints[type][bin];
+                    if (as_dots) {
+                        canvas->drawPoints(SkCanvas::kPoints_PointMode, v.size(), v.data(), paint);
+                    } else {
+                        sk_sp<SkVertices> vertices = SkVertices::MakeCopy(SkVertices::kTriangles_VertexMode,
+                                                                          (int)v.size(), v.data(), nullptr, nullptr);
+                        SkPaint fill = paint;
+                        fill.setStyle(SkPaint::kFill_Style);
+                        canvas->drawVertices(vertices, SkBlendMode::kModulate, fill);
+                    }
+                    v.clear();
+                }
+            }
+        }
+    };
+
+    void drawMods(ModBatch &batch, const Utils::Region *region,
                   const Segs::Align &align,
                   const float width, const float xScaling, const float xOffset, const float mmPosOffset, const float yScaledOffset,
-                  const float pH, const int l_qseq, const float monitorScale, const bool as_dots) {
+                  const float pH, const int l_qseq, const float monitorScale) {
         if (align.any_mods.empty()) {
             return;
         }
-        float precalculated_xOffset_mmPosOffset, h, top, middle, bottom, w;
+        const bool as_dots = batch.as_dots;
+        float precalculated_xOffset_mmPosOffset, h, w;
+        float ys[3];  // y for each modification type (5mC, 5hmC, other)
         if (as_dots) {
             precalculated_xOffset_mmPosOffset = xOffset + mmPosOffset + (0.5 * xScaling);
-            top = yScaledOffset + (pH * 0.3333);
-            middle = yScaledOffset + pH - (pH * 0.5);
-            bottom = yScaledOffset + pH - (pH * 0.3333);
+            ys[0] = yScaledOffset + (pH * 0.3333);
+            ys[2] = yScaledOffset + pH - (pH * 0.5);
+            ys[1] = yScaledOffset + pH - (pH * 0.3333);
+            h = 0;
+            w = 0;
         } else {
             precalculated_xOffset_mmPosOffset = xOffset + mmPosOffset;
             h = pH * 0.25;
-            top = yScaledOffset + h;
-            middle = top + h;
-            bottom = top + h;
+            ys[0] = yScaledOffset + h;
+            ys[2] = ys[0] + h;
+            ys[1] = ys[0] + h;
             w = std::fmax(monitorScale, xScaling);
         }
 
         auto mod_it = align.any_mods.begin();
         auto mod_end = align.any_mods.end();
 
-        auto mc_paint = &theme.ModPaints[0];
-        auto hmc_paint = &theme.ModPaints[1];
-        auto other_paint = &theme.ModPaints[2];
-
-        if (as_dots) {
-            for (const auto& blk : align.blocks) {
-                if ((int)blk.end < region->start) {
-                    continue;
-                } else if ((int)blk.start >= region->end) {
-                    return;
-                }
-                int idx_start = blk.seq_index;
-                int idx_end = blk.seq_index + (blk.end - blk.start);
-                while (mod_it != mod_end && mod_it->index < idx_start) {
-                    ++mod_it;
-                }
-                while (mod_it != mod_end && mod_it->index < idx_end) {
-                    float x = ((((int)blk.start + (int)mod_it->index - idx_start) - region->start) * xScaling) + precalculated_xOffset_mmPosOffset;
-                    if (x < 0) {
-                        ++mod_it;
-                        continue;
-                    }
-                    int n_mods = mod_it->n_mods;
-                    for (size_t j=0; j < (size_t)n_mods; ++j) {
-                        switch (mod_it->mods[j]) {
-                            case 'm':  // 5mC
-                                canvas->drawPoint(x, top, (*mc_paint)[ mod_it->quals[j] % 4 ]);
-                                break;
-                            case 'h':  // 5hmC
-                                canvas->drawPoint(x, bottom, (*hmc_paint)[ mod_it->quals[j] % 4 ]);
-                                break;
-                            default:
-                                canvas->drawPoint(x, middle, (*other_paint)[ mod_it->quals[j] % 4 ]);
-                                break;
-                        }
-                    }
-                    ++mod_it;
-                }
+        for (const auto& blk : align.blocks) {
+            if ((int)blk.end < region->start) {
+                continue;
+            } else if ((int)blk.start >= region->end) {
+                return;
             }
-        } else {
-            for (const auto& blk : align.blocks) {
-                if ((int)blk.end < region->start) {
-                    continue;
-                } else if ((int)blk.start >= region->end) {
-                    return;
-                }
-                int idx_start = blk.seq_index;
-                int idx_end = blk.seq_index + (blk.end - blk.start);
-                while (mod_it != mod_end && mod_it->index < idx_start) {
+            int idx_start = blk.seq_index;
+            int idx_end = blk.seq_index + (blk.end - blk.start);
+            while (mod_it != mod_end && mod_it->index < idx_start) {
+                ++mod_it;
+            }
+            while (mod_it != mod_end && mod_it->index < idx_end) {
+                float x = ((((int)blk.start + (int)mod_it->index - idx_start) - region->start) * xScaling) + precalculated_xOffset_mmPosOffset;
+                if (x < 0) {
                     ++mod_it;
+                    continue;
                 }
-                while (mod_it != mod_end && mod_it->index < idx_end) {
-                    float x = ((((int)blk.start + (int)mod_it->index - idx_start) - region->start) * xScaling) + precalculated_xOffset_mmPosOffset;
-                    if (x < 0) {
-                        ++mod_it;
-                        continue;
-                    }
-                    int n_mods = mod_it->n_mods;
-                    for (size_t j=0; j < (size_t)n_mods; ++j) {
-                        switch (mod_it->mods[j]) {
-                            case 'm':  // 5mC
-                                rect.setXYWH(x, top, w, h);
-                                canvas->drawRect(rect, (*mc_paint)[ mod_it->quals[j] % 4 ]);
-                                break;
-                            case 'h':  // 5hmC
-                                rect.setXYWH(x, bottom, w, h);
-                                canvas->drawRect(rect, (*hmc_paint)[ mod_it->quals[j] % 4 ]);
-                                break;
-                            default:
-                                rect.setXYWH(x, middle, w, h);
-                                canvas->drawRect(rect, (*other_paint)[ mod_it->quals[j] % 4 ]);
-                                break;
-                        }
+                int n_mods = mod_it->n_mods;
+                for (size_t j=0; j < (size_t)n_mods; ++j) {
+                    const int type = modTypeIndex(mod_it->mods[j]);
+                    const int bin = modQualBin(mod_it->quals[j]);
+                    if (as_dots) {
+                        batch.addDot(type, bin, x, ys[type]);
+                    } else {
+                        batch.addRect(type, bin, x, ys[type], w, h);
                     }
-                    ++mod_it;
                 }
+                ++mod_it;
             }
         }
     }
@@ -964,10 +992,15 @@ namespace Drawing {
         SkPath path;
         const Themes::BaseTheme &theme = opts.theme;
 
-        static std::vector<TextItemIns> text_ins;
-        static std::vector<TextItem> text_del;
+        static thread_local std::vector<TextItemIns> text_ins;
         text_ins.clear();
-        text_del.clear();
+        static thread_local std::vector<std::pair<int, float>> ins_lines;  // (Y, x) of insertions drawn over the letters
+        ins_lines.clear();
+        GlyphBatch letters(canvas, fonts.overlay);
+        GlyphBatch text_del(canvas, fonts.overlay);
+        GlyphBatch text_ins_labels(canvas, fonts.overlay);
+        static thread_local ModBatch mods;
+        mods.clear();
 
         const int regionBegin = cl.region->start;
         const int regionEnd = cl.region->end;
@@ -1011,14 +1044,18 @@ namespace Drawing {
         const bool mm_charFits = ( (fonts.overlayCharWidth + (monitorScale*2)) < mm_width - mmPosOffset) &
                     ( (fonts.overlayHeight < pH - (monitorScale)) );
         if (mm_charFits) {
-            initializeTextBlobs(fonts);
             mm_textOffsetX = ((mm_width - mmPosOffset) / 2) - (fonts.overlayCharWidth / 2);
             mm_textOffsetY = (pH / 2) + (fonts.overlayHeight / 2);
         }
 
+        const bool drawModifications = opts.parse_mods && regionLen <= opts.mod_threshold;
+        mods.as_dots = regionLen <= 2000;
+
         cl.skipDrawingReads = true;
+        cl.lodCache.resize(cl.readQueue.size());
 
-        for (const auto &a: cl.readQueue) {
+        for (size_t readIdx = 0; readIdx < cl.readQueue.size(); ++readIdx) {
+            Segs::Align &a = cl.readQueue[readIdx];
             int Y = a.y;
             assert (Y >= -2);
             if (Y < 0) {
@@ -1042,49 +1079,30 @@ namespace Drawing {
             } else {
                 edged = false;
             }
-            double width, s, e; //, textW;
+            double width = 0, s, e; //, textW;
             int lastEnd = 1215752191;
             int starti = 0;
-            size_t idx;
 
-            // draw gapped
+            // draw gapped, using spans merged across sub-pixel gaps
             if (nBlocks > 1) {
-                idx = 1;
-                size_t idx_begin = 0;
-                for (; idx < nBlocks; ++idx) {
-                    starti = (int) a.blocks[idx].start;
-                    lastEnd = (int) a.blocks[idx - 1].end;
-                    if (starti - lastEnd == 0) {
-                        continue;  // insertion, draw over the top later on
-                    }
-                    if (starti - lastEnd >= min_gap_size) {
-                        s = (double)a.blocks[idx_begin].start - regionBegin;
-                        e = (double)a.blocks[idx - 1].end - regionBegin;
-                        width = (e - s) * xScaling;
-                        drawBlock(plotPointedPolygons, pointLeft, edged, (float) s * xScaling, (float) width,
-                                  pointSlop, pH, yScaledOffset, xOffset, canvas, path, rect, faceColor, edgeColor);
-                        idx_begin = idx;
+                Segs::AlignLod &lod = cl.lodCache[readIdx];
+                Segs::alignLevelOfDetail(a, lod, min_gap_size, regionLen, opts.indel_length);
+                for (const auto &span : lod.spans) {
+                    if ((int)span.end < regionBegin || (int)span.start > regionEnd) {
+                        continue;
                     }
+                    s = (double)span.start - regionBegin;
+                    e = (double)span.end - regionBegin;
+                    width = (e - s) * xScaling;
+                    drawBlock(plotPointedPolygons, pointLeft, edged, (float) s * xScaling, (float) width,
+                              pointSlop, pH, yScaledOffset, xOffset, canvas, path, rect, faceColor, edgeColor);
                 }
-                // Draw final block
-                s = (double)a.blocks[idx_begin].start - regionBegin;
-                e = (double)a.blocks[idx - 1].end - regionBegin;
-                width = (e - s) * xScaling;
-                drawBlock(plotPointedPolygons, pointLeft, edged, (float) s * xScaling, (float) width,
-                          pointSlop, pH, yScaledOffset, xOffset, canvas, path, rect, faceColor, edgeColor);
-                idx_begin = idx;
-
-                idx = 1;
-                idx_begin = 0;
-                for (; idx < nBlocks; ++idx) {
-                    starti = (int) a.blocks[idx].start;
-                    lastEnd = (int) a.blocks[idx - 1].end;
-                    if (starti - lastEnd == 0) {
-                        continue;  // insertion
-                    }
+                for (const auto &gap : lod.gaps) {
+                    starti = (int) gap.end;
+                    lastEnd = (int) gap.start;
                     if (lastEnd <= regionEnd && regionBegin <= starti) {
                         drawDeletionLine(canvas, path, opts, fonts, regionBegin, Y, regionLen, starti, lastEnd,
-                            regionPixels, xScaling, yScaling, xOffset, yOffset, text_del, indelTextFits, halfPolygonHeight);
+                            regionPixels, xScaling, yScaling, xOffset, yOffset, text_del, indelTextFits, halfPolygonHeight, monitorScale);
                     }
                 }
 
@@ -1160,7 +1178,8 @@ namespace Drawing {
 
             if (regionLen <= opts.snp_threshold) {
                 drawMismatchesNoMD(canvas, rect, theme, fonts, cl.region, a, mm_width, xScaling, xOffset, mmPosOffset,
-                                   yScaledOffset, pH, l_qseq, mm_vector, cl.collection_processed, mm_charFits, mm_textOffsetX, mm_textOffsetY);
+                                   yScaledOffset, pH, l_qseq, mm_vector, cl.collection_processed, mm_charFits, mm_textOffsetX, mm_textOffsetY,
+                                   letters);
             }
 
             // add insertions
@@ -1172,17 +1191,15 @@ namespace Drawing {
                             if (regionLen < 500000 && indelTextFits) {  // line and text
                                 std::sprintf(indelChars, "%d", ins.length);
                                 size_t sl = strlen(indelChars);
-                                text_ins.emplace_back() = {SkTextBlob::MakeFromString(indelChars, fonts.overlay),
-                                                           p + mm_textOffsetX + xOffset,  // x
-                                                           yScaledOffset - textDrop, // y
-                                                           yScaledOffset,  // box_y
-                                                           fonts.textWidths[sl - 1]};
+                                const float text_x = p + mm_textOffsetX + xOffset;
+                                text_ins.emplace_back(text_x, yScaledOffset, fonts.textWidths[sl - 1]);
+                                text_ins_labels.add(indelChars, text_x, yScaledOffset - textDrop + pH, theme.tcIns);
 
                             } else {  // line only
-                                drawIns(canvas, Y, p, yScaling, xOffset, yOffset, theme.fcIns, rect, pH, ins_block_h, ins_block_w);
+                                ins_lines.emplace_back(Y, p);
                             }
                         } else if (regionLen < opts.small_indel_threshold) {  // line only
-                            drawIns(canvas, Y, p, yScaling, xOffset, yOffset, theme.fcIns, rect, pH, ins_block_h, ins_block_w);
+                            ins_lines.emplace_back(Y, p);
                         }
                     }
                 }
@@ -1203,10 +1220,10 @@ namespace Drawing {
                             rect.setXYWH(p + xOffset + mmPosOffset, yScaledOffset, xScaling * mmScaling, pH);
                             canvas->drawRect(rect, theme.BasePaints[base][colorIdx]);
                             if (mm_charFits) {
-                                canvas->drawTextBlob(lookup_table_bam_textblobs[(int)base],
-                                                   p + xOffset + mmPosOffset + mm_textOffsetX,
-                                                   yScaledOffset + mm_textOffsetY,
-                                                   theme.tcIns);
+                                addBaseLetter(letters, base,
+                                              p + xOffset + mmPosOffset + mm_textOffsetX,
+                                              yScaledOffset + mm_textOffsetY,
+                                              theme.tcIns);
                             }
                             pos += 1;
                         }
@@ -1223,25 +1240,31 @@ namespace Drawing {
                         rect.setXYWH(p + xOffset + mmPosOffset, yScaledOffset, xScaling * mmScaling, pH);
                         canvas->drawRect(rect, theme.BasePaints[base][colorIdx]);
                         if (mm_charFits) {
-                            canvas->drawTextBlob(lookup_table_bam_textblobs[(int)base],
-                                               p + xOffset + mmPosOffset + mm_textOffsetX,
-                                               yScaledOffset + mm_textOffsetY,
-                                               theme.tcIns);
+                            addBaseLetter(letters, base,
+                                          p + xOffset + mmPosOffset + mm_textOffsetX,
+                                          yScaledOffset + mm_textOffsetY,
+                                          theme.tcIns);
                         }
                         pos += 1;
                     }
                 }
             }
             // Add modifications
-            if (opts.parse_mods && regionLen <= opts.mod_threshold) {
-                drawMods(canvas, rect, theme, cl.region, a, (float) width, xScaling, xOffset, mmPosOffset,
-                         yScaledOffset, pH, l_qseq, monitorScale, regionLen <= 2000);
+            if (drawModifications) {
+                drawMods(mods, cl.region, a, (float) width, xScaling, xOffset, mmPosOffset,
+                         yScaledOffset, pH, l_qseq, monitorScale);
             }
         }
-        // draw text deletions + insertions
-        for (const auto &t : text_del) {
-            canvas->drawTextBlob(t.text.get(), t.x + (monitorScale * 0.5), t.y, theme.tcDel);
+        // insertions and modifications are drawn over the base letters
+        letters.flush();
+        for (const auto &ins : ins_lines) {
+            drawIns(canvas, ins.first, ins.second, yScaling, xOffset, yOffset, theme.fcIns, rect, pH, ins_block_h, ins_block_w);
+        }
+        if (drawModifications) {
+            mods.flush(canvas, theme);
         }
+        // draw text deletions + insertions
+        text_del.flush();
         for (const auto &t : text_ins) {
             rect.setXYWH(t.x - monitorScale, t.box_y, t.box_w, pH);  // middle
             canvas->drawRect(rect, theme.fcIns);
@@ -1249,8 +1272,8 @@ namespace Drawing {
             canvas->drawRect(rect, theme.fcIns);
             rect.setXYWH(t.x - monitorScale - ins_block_h, t.box_y + pH - ins_block_h, t.box_w + ins_block_h + ins_block_h, ins_block_h);  // bottom
             canvas->drawRect(rect, theme.fcIns);
-            canvas->drawTextBlob(t.text.get(), t.x, t.y + pH, theme.tcIns);
         }
+        text_ins_labels.flush();
 
         // draw connecting lines between linked alignments
         if (linkOp > 0) {
@@ -1343,6 +1366,91 @@ namespace Drawing {
         }
     }
 
+    // Nibble code (see Utils::nibbleSequence) to reference paint. nullptr is not drawn
+    inline std::array<const SkPaint *, 16> refBasePaints(const Themes::BaseTheme &theme) {
+        std::array<const SkPaint *, 16> paints{};
+        paints[1] = &theme.fcA;
+        paints[2] = &theme.fcC;
+        paints[4] = &theme.fcG;
+        paints[8] = &theme.fcT;
+        paints[15] = &theme.fcN;
+        return paints;
+    }
+
+    /*
+     * The reference row of a region, pre-coloured as a pixel row with one pixel per base (or 10 pixels, with a
+     * transparent last pixel, when bases are drawn with a gap). Blitted with a single drawImageRect and only
+     * rebuilt when the region, gap mode or theme colours change.
+     */
+    struct RefStripKey {
+        std::string chrom;
+        int start, length;
+        uint64_t sequenceHash;  // another reference can have the same contig names
+        bool gapped;
+        std::array<SkColor, 5> colors;
+        bool operator==(const RefStripKey &o) const {
+            return start == o.start && length == o.length && sequenceHash == o.sequenceHash && gapped == o.gapped &&
+                   colors == o.colors && chrom == o.chrom;
+        }
+    };
+
+    uint64_t hashBases(const std::vector<uint8_t> &bases) {  // FNV-1a
+        uint64_t h = 14695981039346656037ULL;
+        for (const uint8_t b : bases) {
+            h = (h ^ b) * 1099511628211ULL;
+        }
+        return h;
+    }
+
+    sk_sp<SkImage> getRefStrip(const Utils::Region &rgn, const Themes::BaseTheme &theme, const bool gapped) {
+        constexpr size_t maxStrips = 32;
+        constexpr int gappedPixels = 10;
+        thread_local std::vector<std::pair<RefStripKey, sk_sp<SkImage>>> cache;
+
+        const std::vector<uint8_t> &bases = rgn.refSeq_nibbled;
+        if (bases.empty()) {
+            return nullptr;
+        }
+        RefStripKey key{rgn.chrom, rgn.start, (int)bases.size(), hashBases(bases), gapped,
+                        {theme.fcA.getColor(), theme.fcC.getColor(), theme.fcG.getColor(), theme.fcT.getColor(),
+                         theme.fcN.getColor()}};
+        for (auto it = cache.begin(); it != cache.end(); ++it) {
+            if (it->first == key) {
+                return it->second;
+            }
+        }
+
+        const std::array<const SkPaint *, 16> paints = refBasePaints(theme);
+        const int pxPerBase = (gapped) ? gappedPixels : 1;
+        SkBitmap bitmap;
+        if (!bitmap.tryAllocN32Pixels((int)bases.size() * pxPerBase, 1)) {
+            return nullptr;
+        }
+        uint32_t *row = bitmap.getAddr32(0, 0);
+        for (size_t i = 0; i < bases.size(); ++i) {
+            const SkPaint *p = paints[bases[i] & 15];
+            const SkPMColor c = (p) ? SkPreMultiplyColor(p->getColor()) : 0;
+            uint32_t *px = row + (i * pxPerBase);
+            for (int j = 0; j < pxPerBase; ++j) {
+                px[j] = c;
+            }
+            if (gapped) {
+                px[pxPerBase - 1] = 0;
+            }
+        }
+        bitmap.setImmutable();
+#if !defined(OLD_SKIA) || OLD_SKIA == 0
+        sk_sp<SkImage> strip = SkImages::RasterFromBitmap(bitmap);
+#else
+        sk_sp<SkImage> strip = SkImage::MakeFromBitmap(bitmap);
+#endif
+        if (cache.size() >= maxStrips) {
+            cache.erase(cache.begin());
+        }
+        cache.emplace_back(std::move(key), strip);
+        return strip;
+    }
+
     void drawRef(const Themes::IniOptions &opts,
                  std::vector<Utils::Region> &regions,
                  SkCanvas *const canvas, const Themes::Fonts &fonts, const drawContext& ctx) {
@@ -1353,8 +1461,11 @@ namespace Drawing {
             return;
         }
         SkRect rect;
-        SkPaint faceColor;
         const Themes::BaseTheme &theme = opts.theme;
+        const std::array<const SkPaint *, 16> paints = refBasePaints(theme);
+        GlyphBatch letters(canvas, fonts.overlay);
+        // Vector output keeps one rect per base rather than a scaled image
+        const bool vectorBackend = canvas->imageInfo().colorType() == kUnknown_SkColorType;
         const double regionW = (double) fb_width / (double) regions.size();
         const double xPixels = regionW - gap - gap;
         const float textW = fonts.overlayWidth;
@@ -1374,6 +1485,7 @@ namespace Drawing {
             if (ref == nullptr) {
                 continue;
             }
+            const std::vector<uint8_t> &bases = rgn.refSeq_nibbled;
             double mmScaling;
             if (size < 250) {
                 mmScaling = 0.9 * xScaling;
@@ -1384,82 +1496,28 @@ namespace Drawing {
             i += gap;
             if (textW > 0 && (float) size < minLetterSize && fonts.overlayHeight <= refSpace * 1.35) {
                 const double v = (xScaling - textW) * 0.5;
-
-                while (*ref) {
-                    switch ((unsigned int) *ref) {
-                        case 65:
-                            faceColor = theme.fcA;
-                            break;
-                        case 67:
-                            faceColor = theme.fcC;
-                            break;
-                        case 71:
-                            faceColor = theme.fcG;
-                            break;
-                        case 78:
-                            faceColor = theme.fcN;
-                            break;
-                        case 84:
-                            faceColor = theme.fcT;
-                            break;
-                        case 97:
-                            faceColor = theme.fcA;
-                            break;
-                        case 99:
-                            faceColor = theme.fcC;
-                            break;
-                        case 103:
-                            faceColor = theme.fcG;
-                            break;
-                        case 110:
-                            faceColor = theme.fcN;
-                            break;
-                        case 116:
-                            faceColor = theme.fcT;
-                            break;
-                    }
-                    canvas->drawTextBlob(SkTextBlob::MakeFromText(ref, 1, fonts.overlay, SkTextEncoding::kUTF8),
-                                         i + v, yp, faceColor);
+                for (size_t k = 0; k < bases.size(); ++k) {
+                    const SkPaint *p = paints[bases[k] & 15];
+                    letters.add(ref[k], i + v, yp, (p) ? *p : theme.fcN);
                     i += xScaling;
-                    ++ref;
                 }
+                letters.flush();  // before the next region, which covers any overhang
             } else if (size < 20000) {
-                while (*ref) {
-                    rect.setXYWH(i, mmPosOffset, mmScaling, boxHeight);
-                    switch ((unsigned int) *ref) {
-                        case 65:
-                            canvas->drawRect(rect, theme.fcA);
-                            break;
-                        case 67:
-                            canvas->drawRect(rect, theme.fcC);
-                            break;
-                        case 71:
-                            canvas->drawRect(rect, theme.fcG);
-                            break;
-                        case 78:
-                            canvas->drawRect(rect, theme.fcN);
-                            break;
-                        case 84:
-                            canvas->drawRect(rect, theme.fcT);
-                            break;
-                        case 97:
-                            canvas->drawRect(rect, theme.fcA);
-                            break;
-                        case 99:
-                            canvas->drawRect(rect, theme.fcC);
-                            break;
-                        case 103:
-                            canvas->drawRect(rect, theme.fcG);
-                            break;
-                        case 110:
-                            canvas->drawRect(rect, theme.fcN);
-                            break;
-                        case 116:
-                            canvas->drawRect(rect, theme.fcT);
-                            break;
+                if (!vectorBackend) {
+                    sk_sp<SkImage> strip = getRefStrip(rgn, theme, size < 250);
+                    if (strip) {
+                        rect.setXYWH(i, mmPosOffset, xScaling * (double) bases.size(), boxHeight);
+                        canvas->drawImageRect(strip, rect, SkSamplingOptions(SkFilterMode::kNearest));
+                    }
+                } else {
+                    for (const uint8_t b : bases) {
+                        const SkPaint *p = paints[b & 15];
+                        if (p) {
+                            rect.setXYWH(i, mmPosOffset, mmScaling, boxHeight);
+                            canvas->drawRect(rect, *p);
+                        }
+                        i += xScaling;
                     }
-                    i += xScaling;
-                    ++ref;
                 }
             }
             index += 1;
@@ -1612,15 +1670,18 @@ namespace Drawing {
         const float gap = ctx.gap;
         const float gap2 = 2 * gap;
         
-        if (trk.bigWig_intervals == nullptr || trk.bigWig_intervals->l == 0) {
+        if (trk.bigWig_intervals == nullptr || trk.bigWig_end <= trk.bigWig_begin) {
             return;
         }
         // see chr19:5,930,464-5,931,225 in test/test_fixedStep.bigwig
+        // Intervals are shared with the fetch cache of the track, so values are scaled on the fly
         float cMax = -std::numeric_limits<float>::max();
         float cMin = std::numeric_limits<float>::max();
         float v;
-        int length = (int) trk.bigWig_intervals->l;
-        for (int i = 0; i < length; ++i) {
+        const int first = (int) trk.bigWig_begin;
+        const int last = (int) trk.bigWig_end;
+        int length = last - first;
+        for (int i = first; i < last; ++i) {
             v = trk.bigWig_intervals->value[i];
             cMin = std::fmin(v, cMin);
             cMax = std::fmax(v, cMax);
@@ -1637,12 +1698,6 @@ namespace Drawing {
         if (range == 0.0f) {
             range = 1.0f;
         }
-        // normalize to space available
-        for (int i = 0; i < length; ++i) {
-            float &vi = trk.bigWig_intervals->value[i];
-            vi = vi / range;
-        }
-
         float startY = y + availableSPace + (gap * 0.5);
         float x = padX;
     //        if (y_negativeValueOffset != 0) {
@@ -1653,15 +1708,19 @@ namespace Drawing {
     //        }
         int step = length / 100000;
         step = (step) ? step : 1;
-        for (int i = 0; i < length; i += step) {
-            if ((int)trk.bigWig_intervals->start[i] < rgn.start) {
+        // Per-base values have no end, zoom level records span several bases
+        const uint32_t *ends = trk.bigWig_intervals->end;
+        for (int i = first; i < last; i += step) {
+            const int s = (int)trk.bigWig_intervals->start[i];
+            const int e = (ends) ? (int)ends[i] : s + 1;
+            if (e <= rgn.start) {
                 continue;
-            } else if ((int)trk.bigWig_intervals->start[i] >= rgn.end) {
+            } else if (s >= rgn.end) {
                 break;
             }
-            v = trk.bigWig_intervals->value[i];
-            x = padX + (((float)trk.bigWig_intervals->start[i] - (float)rgn.start) * xScaling);
-            rect.setXYWH(x, startY - y_negativeValueOffset, std::fmax(1, xScaling), -v * availableSPace);
+            v = trk.bigWig_intervals->value[i] / range;  // normalize to space available
+            x = padX + (((float)s - (float)rgn.start) * xScaling);
+            rect.setXYWH(x, startY - y_negativeValueOffset, std::fmax(1, (float)(e - s) * xScaling), -v * availableSPace);
             canvas->drawRect(rect, faceColour);
         }
         if (availableSPace > 2 * fonts.overlayHeight) {
@@ -2073,7 +2132,7 @@ namespace Drawing {
             float padY = gap;
             int trackIdx = 0;
 
-            rgn.featuresInView.clear();
+            // Feature blocks are kept between frames and overwritten by collectTrackData
             rgn.featuresInView.resize(tracks.size());
             rgn.featureLevels.clear();
             rgn.featureLevels.resize(tracks.size());
@@ -2087,9 +2146,24 @@ namespace Drawing {
                 canvas->clipRect({padX, y + padY, right, fb_height}, false);
 
                 if (trk.kind != HGW::INTRON) {
+                    trk.bigWig_basesPerPixel = 1 / xScaling;
                     trk.fetch(&rgn);
                 }
+                if (trk.loading) {  // read in the background, the frame is drawn again once it arrives
+                    rgn.featuresInView[trackIdx].clear();
+                    // placed where the track itself will be drawn, bigWig tracks do not advance padY
+                    const float top = (trk.kind == HGW::BIGWIG) ? y + (trk.px_height * trackIdx) : y + padY;
+                    sk_sp<SkTextBlob> blob = SkTextBlob::MakeFromString("Loading...", fonts.overlay);
+                    canvas->drawTextBlob(blob, padX + t, top + fonts.overlayHeight * 2, opts.theme.tcDel);
+                    trackIdx += 1;
+                    if (trk.kind != HGW::BIGWIG) {
+                        padY += trk.px_height;
+                    }
+                    canvas->restore();
+                    continue;
+                }
                 if (trk.kind == HGW::BIGWIG) {
+                    rgn.featuresInView[trackIdx].clear();
                     drawTrackBigWig(trk, rgn, rect, padX, padY, y + (trk.px_height * trackIdx), stepX, trk.px_height,
                                     xScaling, t, opts, canvas, fonts, faceColour, ctx);
                     trackIdx += 1;
@@ -2103,8 +2177,8 @@ namespace Drawing {
 
                 // features are the visible blocks (bed, genes, transcripts etc)
                 std::vector<Utils::TrackBlock> &features = rgn.featuresInView[trackIdx];
-                features.clear();
                 if (trk.kind == HGW::INTRON) {
+                    features.clear();
                     if (collections != nullptr && trk.bamIndex >= 0) {
                         // Match the ReadCollection for this bam + this region.
                         for (auto& rc : *collections) {
@@ -2327,6 +2401,76 @@ namespace Drawing {
         return interval;
     }
 
+    /*
+     * The ideogram strip of a chromosome (centre line plus bands) only depends on the chromosome, the strip size
+     * and the paints, so it is recorded once into a picture with its top-left at the origin. Batch jobs
+     * redraw the same strip for every image, and only the position marker changes between frames.
+     */
+    struct IdeogramStripKey {
+        std::string chrom;
+        int chromLen;
+        float width, height;
+        SkColor lineColor, bandEdgeColor;
+        uint64_t ideogramGeneration;  // identity of the loaded ideogram
+        bool hasBands;
+        bool operator==(const IdeogramStripKey &o) const {
+            return chromLen == o.chromLen && width == o.width && height == o.height && lineColor == o.lineColor &&
+                   bandEdgeColor == o.bandEdgeColor && ideogramGeneration == o.ideogramGeneration &&
+                   hasBands == o.hasBands && chrom == o.chrom;
+        }
+    };
+
+    sk_sp<SkPicture> recordIdeogramStrip(const int chromLen, const std::vector<Ideo::Band> *bands,
+                                         const float drawWidth, const float height,
+                                         const SkPaint &line, const SkPaint &light_paint) {
+        SkPictureRecorder recorder;
+        const float pad = line.getStrokeWidth() + 1;
+        SkCanvas *canvas = recorder.beginRecording(SkRect::MakeLTRB(-pad, -pad, drawWidth + pad, height + pad));
+        SkPath path;
+        path.moveTo(0, height / 2);
+        path.lineTo(drawWidth, height / 2);
+        canvas->drawPath(path, line);
+        if (bands != nullptr) {
+            SkRect rect{};
+            for (const auto& b : *bands) {
+                float sb = (float) b.start / (float)chromLen;
+                float eb = (float) b.end / (float)chromLen;
+                float wb = (eb - sb) * drawWidth;
+                rect.setXYWH(sb * drawWidth, 0, wb, height);
+                canvas->drawRect(rect, b.paint);
+                if (wb > 2) {
+                    canvas->drawRect(rect, light_paint);
+                }
+            }
+        }
+        return recorder.finishRecordingAsPicture();
+    }
+
+    sk_sp<SkPicture> getIdeogramStrip(const std::string &chrom, const int chromLen, const std::vector<Ideo::Band> *bands,
+                                      const uint64_t ideogramGeneration, const std::string &theme,
+                                      const float drawWidth, const float height,
+                                      const SkPaint &line, const SkPaint &light_paint) {
+        constexpr size_t maxStrips = 256;
+        thread_local std::vector<std::pair<IdeogramStripKey, sk_sp<SkPicture>>> cache;
+        thread_local std::string cacheTheme;
+        if (theme != cacheTheme) {  // band colours are taken from the theme
+            cache.clear();
+            cacheTheme = theme;
+        }
+        IdeogramStripKey key{chrom, chromLen, drawWidth, height, line.getColor(), light_paint.getColor(),
+                             ideogramGeneration, bands != nullptr};
+        for (const auto &item : cache) {
+            if (item.first == key) {
+                return item.second;
+            }
+        }
+        if (cache.size() >= maxStrips) {
+            cache.clear();
+        }
+        cache.emplace_back(std::move(key), recordIdeogramStrip(chromLen, bands, drawWidth, height, line, light_paint));
+        return cache.back().second;
+    }
+
     // draw scale bar and ideogram
     void drawChromLocation(const Themes::IniOptions &opts,
                            const Themes::Fonts &fonts,
@@ -2362,7 +2506,6 @@ namespace Drawing {
         // Ideogram box
         float ideo_box_height = plot_gap;
         float ideo_box_top = fb_height - (plot_gap * 2.5);
-        float horizontal_line = ideo_box_top + (ideo_box_height / 2);;
 
         float yh = std::fmax((float) (fb_height * 0.0175), 10 * monitorScale);
 
@@ -2370,6 +2513,8 @@ namespace Drawing {
 
 
         float chrom_name_text_bottom = fb_height - plot_gap - plot_gap + (fonts.overlayHeight / 2);
+        GlyphBatch chromText(canvas, fonts.overlay);
+        GlyphBatch tickText(canvas, fonts.overlay);
         float regionIdx = 0;
         for (auto& region: regions) {
 
@@ -2378,10 +2523,9 @@ namespace Drawing {
                 continue;
             }
 
-            sk_sp<SkTextBlob> blob = SkTextBlob::MakeFromString(region.chrom.c_str(), fonts.overlay);
-            canvas->drawTextBlob(blob, (regionIdx * colWidth) + plot_gap, chrom_name_text_bottom, opts.theme.tcDel);
+            chromText.add(region.chrom.c_str(), (regionIdx * colWidth) + plot_gap, chrom_name_text_bottom, opts.theme.tcDel);
 
-            region.chromNameWidth = fonts.measureTextWidth(region.chrom);
+            region.chromNameWidth = chromText.measure(region.chrom.c_str());
 
             float h_gap = region.chromNameWidth + plot_gap + plot_gap;
 
@@ -2406,28 +2550,14 @@ namespace Drawing {
             region.ideogramEnd = xp + drawWidth;
 
             if (addLocation || !ideogram.empty()) {
-                path.reset();
-                path.moveTo(region.ideogramStart, horizontal_line );
-                path.lineTo(region.ideogramEnd, horizontal_line);
-                canvas->drawPath(path, line);
-
                 auto it = ideogram.find(region.chrom);
-                if (it != ideogram.end()) {
-                    const std::vector<Ideo::Band>& bands = it->second;
-                    for (const auto& b : bands) {
-                        float sb = (float) b.start / (float)region.chromLen;
-                        float eb = (float) b.end / (float)region.chromLen;
-                        float wb = (eb - sb) * drawWidth;
-                        rect.setXYWH(xp + (sb * drawWidth),
-                                     ideo_box_top,
-                                     wb,
-                                     ideo_box_height);
-                        canvas->drawRect(rect, b.paint);
-                        if (wb > 2) {
-                            canvas->drawRect(rect, light_paint);
-                        }
-                    }
-                }
+                const std::vector<Ideo::Band> *bands = (it != ideogram.end()) ? &it->second : nullptr;
+                sk_sp<SkPicture> strip = getIdeogramStrip(region.chrom, region.chromLen, bands, ctx.ideogramGeneration,
+                                                          opts.theme_str, drawWidth, ideo_box_height, line, light_paint);
+                canvas->save();
+                canvas->translate(xp, ideo_box_top);
+                canvas->drawPicture(strip);
+                canvas->restore();
             }
             if (addLocation) {
                 rect.setXYWH(xp + (s * drawWidth),
@@ -2489,13 +2619,13 @@ namespace Drawing {
 
                     posToText(position, region.regionLen, text);
 
-                    sk_sp<SkTextBlob> blob = SkTextBlob::MakeFromString(text.c_str(), fonts.overlay);
-                    float text_width = fonts.overlay.measureText(text.c_str(), text.length(), SkTextEncoding::kUTF8);
+                    float text_width = tickText.measure(text.c_str());
                     float t_half = text_width * 0.5;
-                    canvas->drawTextBlob(blob, x_pos - t_half, top2, opts.theme.tcDel);
+                    tickText.add(text.c_str(), x_pos - t_half, top2, opts.theme.tcDel);
                     last = text;
                     position += nice_tick;
                 }
+                tickText.flush();  // must be drawn inside the clip
                 canvas->restore();
 
             }
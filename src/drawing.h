@@ -59,6 +59,7 @@ namespace Drawing {
         float topMenuSpace;
         float overlayHeight;
         bool drawLocation;
+        uint64_t ideogramGeneration = 0;  // changes whenever an ideogram is loaded
         std::string selectedIntronChrom;  // identity of the highlighted intron (empty = none)
         int selectedIntronStart = -1;
         int selectedIntronEnd = -1;
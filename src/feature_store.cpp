@@ -0,0 +1,132 @@
+#include "feature_store.h"
+
+#include <algorithm>
+
+namespace {
+
+    constexpr uint64_t maxTextOffset = (1ULL << 40) - 1;
+    constexpr uint64_t maxTextLength = (1ULL << 23) - 1;
+
+}
+
+namespace HGW {
+
+    FeatureStore::FeatureStore() {
+        interned.emplace_back();
+        internIds[std::string_view(interned.back())] = 0;
+    }
+
+    FeatureStore::FeatureStore(const FeatureStore &other)
+        : interned(other.interned), arena(other.arena), mappedOwner(other.mappedOwner),
+          mappedBase(other.mappedBase), mappedSize(other.mappedSize) {
+        internIds.reserve(interned.size());
+        for (uint32_t i = 0; i < (uint32_t)interned.size(); ++i) {
+            internIds[std::string_view(interned[i])] = i;
+        }
+    }
+
+    uint32_t FeatureStore::intern(std::string_view s) {
+        auto it = internIds.find(s);
+        if (it != internIds.end()) {
+            return it->second;
+        }
+        const auto id = (uint32_t)interned.size();
+        interned.emplace_back(s);
+        internIds[std::string_view(interned.back())] = id;
+        return id;
+    }
+
+    TextRef FeatureStore::addText(std::string_view s) {
+        TextRef r{};
+        if (s.empty() || arena.size() > maxTextOffset) {
+            return r;
+        }
+        // Longer strings are truncated; no annotation field comes close to this
+        const uint64_t len = std::min<uint64_t>(s.size(), maxTextLength);
+        r.off = arena.size();
+        r.len = len;
+        arena.append(s.data(), (size_t)len);
+        return r;
+    }
+
+    TextRef FeatureStore::subText(TextRef whole, std::string_view wholeView, std::string_view part) {
+        TextRef r{};
+        if (part.empty() || part.data() < wholeView.data() ||
+            part.data() + part.size() > wholeView.data() + wholeView.size()) {
+            return r;
+        }
+        r.off = whole.off + (uint64_t)(part.data() - wholeView.data());
+        r.len = part.size();
+        r.mapped = whole.mapped;
+        return r;
+    }
+
+    std::string_view FeatureStore::text(TextRef r) const {
+        if (r.len == 0) {
+            return {};
+        }
+        if (r.mapped) {
+            return {mappedBase + r.off, (size_t)r.len};
+        }
+        return {arena.data() + r.off, (size_t)r.len};
+    }
+
+    void FeatureStore::setMapped(std::shared_ptr<const void> owner, const char *base, uint64_t size) {
+        mappedOwner = std::move(owner);
+        mappedBase = base;
+        mappedSize = size;
+    }
+
+    TextRef FeatureStore::mappedText(uint64_t off, uint64_t len) const {
+        TextRef r{};
+        if (len == 0 || off > mappedSize || len > mappedSize - off || off > maxTextOffset) {
+            return r;
+        }
+        r.off = off;
+        r.len = std::min<uint64_t>(len, maxTextLength);
+        r.mapped = 1;
+        return r;
+    }
+
+    FeatureRecord FeatureStore::makeRecord(const Utils::TrackBlock &b) {
+        FeatureRecord r{};
+        r.start = b.start;
+        r.end = b.end;
+        r.strand = b.strand;
+        r.chrom = intern(b.chrom);
+        r.vartype = intern(b.vartype);
+        r.parent = intern(b.parent);
+        r.line = addText(b.line);
+        r.name = addText(b.name);
+        r.uniqueId = addText(b.unique_id);
+        return r;
+    }
+
+    void FeatureStore::Rebase::apply(FeatureRecord &r) const {
+        r.chrom = ids[r.chrom];
+        r.vartype = ids[r.vartype];
+        r.parent = ids[r.parent];
+        for (TextRef *t : {&r.line, &r.name, &r.uniqueId}) {
+            if (t->len != 0 && !t->mapped) {
+                t->off += textOffset;
+            }
+        }
+    }
+
+    FeatureStore::Rebase FeatureStore::absorb(FeatureStore &&other) {
+        Rebase rb;
+        rb.ids.reserve(other.interned.size());
+        for (const auto &s : other.interned) {
+            rb.ids.push_back(intern(s));
+        }
+        if (arena.empty()) {
+            arena = std::move(other.arena);
+        } else {
+            rb.textOffset = arena.size();
+            arena.append(other.arena);
+        }
+        other = FeatureStore();
+        return rb;
+    }
+
+}
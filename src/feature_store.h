@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ankerl_unordered_dense.h"
+#include "utils.h"
+
+namespace HGW {
+
+    // Location of a string held by a FeatureStore, either in its own text arena or, for tracks
+    // opened from a binary sidecar, in the string pool of the mapped file
+    struct TextRef {
+        uint64_t off : 40;
+        uint64_t len : 23;
+        uint64_t mapped : 1;
+    };
+
+    // Per-feature record kept for non-indexed tracks, in place of a full Utils::TrackBlock.
+    // Repetitive strings (chrom, feature type, parent) are interned ids, and the raw line, name
+    // and unique id are references into the store. Columns of the line are split only when needed.
+    struct FeatureRecord {
+        int32_t start, end;
+        uint32_t chrom, vartype, parent;  // FeatureStore::intern ids, 0 is the empty string
+        int32_t strand;  // 0 is none, 1 forward, 2 reverse
+        TextRef line, name, uniqueId;
+    };
+
+    class FeatureStore {
+    public:
+        FeatureStore();
+        // The keys of internIds are views into interned, so a copy rebuilds them over its own strings
+        FeatureStore(const FeatureStore &other);
+        FeatureStore(FeatureStore &&) = default;
+        FeatureStore &operator=(FeatureStore &&) = default;
+
+        uint32_t intern(std::string_view s);
+        std::string_view str(uint32_t id) const { return interned[id]; }
+
+        // Copies s into the arena
+        TextRef addText(std::string_view s);
+        // Reference to a part of text that was already stored as whole, without copying it
+        static TextRef subText(TextRef whole, std::string_view wholeView, std::string_view part);
+        std::string_view text(TextRef r) const;
+        size_t textBytes() const { return arena.size(); }
+
+        // Strings of sidecar records stay in the mapped file. owner keeps the mapping alive
+        void setMapped(std::shared_ptr<const void> owner, const char *base, uint64_t size);
+        TextRef mappedText(uint64_t off, uint64_t len) const;
+
+        FeatureRecord makeRecord(const Utils::TrackBlock &b);
+
+        // Maps records of a store that was moved into another one with absorb
+        struct Rebase {
+            std::vector<uint32_t> ids;
+            uint64_t textOffset{0};
+            void apply(FeatureRecord &r) const;
+        };
+        // Moves the strings of other, e.g. a store filled by a loader thread, to the end of this one
+        Rebase absorb(FeatureStore &&other);
+
+    private:
+        std::deque<std::string> interned;  // deque so the views used as map keys stay valid
+        ankerl::unordered_dense::map<std::string_view, uint32_t> internIds;
+        std::string arena;
+        std::shared_ptr<const void> mappedOwner;
+        const char *mappedBase{nullptr};
+        uint64_t mappedSize{0};
+    };
+
+}
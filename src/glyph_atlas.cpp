@@ -0,0 +1,182 @@
+//
+// Glyph atlas for per-frame text (base letters, indel counts, coverage and ruler labels)
+//
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "include/core/SkFontMetrics.h"
+#include "include/core/SkImageInfo.h"
+#include "include/core/SkSurface.h"
+#include "include/core/SkTypeface.h"
+
+#include "glyph_atlas.h"
+
+
+namespace Drawing {
+
+    bool GlyphAtlas::build(const SkFont &font) {
+        constexpr int n = lastChar - firstChar + 1;
+        constexpr int columns = 16;
+        constexpr int pad = 1;
+        char chars[n];
+        SkGlyphID glyphs[n];
+        SkScalar widths[n];
+        SkRect bounds[n];
+        for (int i = 0; i < n; ++i) {
+            chars[i] = (char)(firstChar + i);
+        }
+        font.textToGlyphs(chars, n, SkTextEncoding::kUTF8, glyphs, n);
+        font.getWidthsBounds(glyphs, n, widths, bounds, nullptr);
+
+        SkFontMetrics metrics;
+        font.getMetrics(&metrics);
+        float left = 0, right = 0;
+        float top = metrics.fAscent, bottom = metrics.fDescent;
+        for (int i = 0; i < n; ++i) {
+            left = std::fmin(left, bounds[i].fLeft);
+            right = std::fmax(right, std::fmax(widths[i], bounds[i].fRight));
+            top = std::fmin(top, bounds[i].fTop);
+            bottom = std::fmax(bottom, bounds[i].fBottom);
+        }
+        // Pen position inside each cell, so that every glyph fits a uniform cell
+        const float penX = pad - std::floor(left);
+        const float penY = pad - std::floor(top);
+        const int cellW = (int)std::ceil(penX + right) + pad;
+        const int cellH = (int)std::ceil(penY + bottom) + pad;
+        const int rows = (n + columns - 1) / columns;
+        if (cellW <= 0 || cellH <= 0) {
+            return false;
+        }
+
+        SkImageInfo info = SkImageInfo::MakeN32Premul(cellW * columns, cellH * rows);
+#if !defined(OLD_SKIA) || OLD_SKIA == 0
+        sk_sp<SkSurface> surface = SkSurfaces::Raster(info);
+#else
+        sk_sp<SkSurface> surface = SkSurface::MakeRaster(info);
+#endif
+        if (!surface) {
+            return false;
+        }
+        SkCanvas *canvas = surface->getCanvas();
+        canvas->clear(SK_ColorTRANSPARENT);
+        SkPaint white;
+        white.setColor(SK_ColorWHITE);
+        white.setAntiAlias(true);
+
+        for (int i = 0; i < n; ++i) {
+            const int c = firstChar + i;
+            const float cx = (float)((i % columns) * cellW);
+            const float cy = (float)((i / columns) * cellH);
+            canvas->drawSimpleText(&chars[i], 1, SkTextEncoding::kUTF8, cx + penX, cy + penY, font, white);
+            tex[c] = SkRect::MakeXYWH(cx, cy, (float)cellW, (float)cellH);
+            origin[c] = SkPoint::Make(-penX, -penY);
+            advance[c] = widths[i];
+        }
+        image = surface->makeImageSnapshot();
+        return image != nullptr;
+    }
+
+    const GlyphAtlas *GlyphAtlas::get(const SkFont &font) {
+        // Drawing runs on one thread per GwPlot in batch mode, so each thread keeps its own atlases
+        constexpr size_t maxAtlases = 8;
+        struct Entry {
+            uint32_t typefaceId;
+            SkScalar size;
+            std::unique_ptr<GlyphAtlas> atlas;
+        };
+        thread_local std::vector<Entry> cache;
+
+        const SkTypeface *face = font.getTypeface();
+        const uint32_t typefaceId = (face) ? (uint32_t)face->uniqueID() : 0;
+        const SkScalar size = font.getSize();
+        for (const auto &e : cache) {
+            if (e.typefaceId == typefaceId && e.size == size) {
+                return e.atlas.get();
+            }
+        }
+        auto atlas = std::make_unique<GlyphAtlas>();
+        if (!atlas->build(font)) {
+            return nullptr;
+        }
+        if (cache.size() >= maxAtlases) {  // font size changes are rare, drop the oldest
+            cache.erase(cache.begin());
+        }
+        cache.push_back({typefaceId, size, std::move(atlas)});
+        return cache.back().atlas.get();
+    }
+
+    GlyphBatch::GlyphBatch(SkCanvas *canvas, const SkFont &font) : canvas(canvas), font(font) {
+        const bool vectorBackend = canvas->imageInfo().colorType() == kUnknown_SkColorType;
+        atlas = (vectorBackend) ? nullptr : GlyphAtlas::get(font);
+    }
+
+    GlyphBatch::~GlyphBatch() {
+        flush();
+    }
+
+    void GlyphBatch::add(char c, float x, float y, const SkPaint &paint) {
+        if (atlas == nullptr || !atlas->has(c)) {
+            pending.push_back({std::string(1, c), x, y, paint.getColor()});
+            return;
+        }
+        const SkPoint &o = atlas->origin[(unsigned char)c];
+        xforms.push_back(SkRSXform::Make(1, 0, x + o.fX, y + o.fY));
+        rects.push_back(atlas->tex[(unsigned char)c]);
+        colors.push_back(paint.getColor());
+    }
+
+    void GlyphBatch::add(const char *text, float x, float y, const SkPaint &paint) {
+        if (atlas == nullptr) {
+            pending.push_back({std::string(text), x, y, paint.getColor()});
+            return;
+        }
+        for (const char *p = text; *p; ++p) {
+            if (!atlas->has(*p)) {
+                pending.push_back({std::string(text), x, y, paint.getColor()});
+                return;
+            }
+        }
+        for (const char *p = text; *p; ++p) {
+            add(*p, x, y, paint);
+            x += atlas->advance[(unsigned char)*p];
+        }
+    }
+
+    float GlyphBatch::measure(const char *text) const {
+        if (atlas == nullptr) {
+            return font.measureText(text, std::strlen(text), SkTextEncoding::kUTF8);
+        }
+        float w = 0;
+        for (const char *p = text; *p; ++p) {
+            if (!atlas->has(*p)) {
+                return font.measureText(text, std::strlen(text), SkTextEncoding::kUTF8);
+            }
+            w += atlas->advance[(unsigned char)*p];
+        }
+        return w;
+    }
+
+    void GlyphBatch::flush() {
+        if (!xforms.empty()) {
+            canvas->drawAtlas(atlas->image.get(), xforms.data(), rects.data(), colors.data(), (int)xforms.size(),
+                              SkBlendMode::kModulate, SkSamplingOptions(SkFilterMode::kNearest), nullptr, nullptr);
+            xforms.clear();
+            rects.clear();
+            colors.clear();
+        }
+        if (!pending.empty()) {
+            SkPaint paint;
+            paint.setAntiAlias(true);
+            for (const auto &t : pending) {
+                paint.setColor(t.color);
+                canvas->drawSimpleText(t.text.c_str(), t.text.size(), SkTextEncoding::kUTF8, t.x, t.y, font, paint);
+            }
+            pending.clear();
+        }
+    }
+
+}
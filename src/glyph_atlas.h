@@ -0,0 +1,73 @@
+//
+// Glyph atlas for per-frame text (base letters, indel counts, coverage and ruler labels)
+//
+
+#pragma once
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include "include/core/SkCanvas.h"
+#include "include/core/SkFont.h"
+#include "include/core/SkImage.h"
+#include "include/core/SkPaint.h"
+#include "include/core/SkRect.h"
+#include "include/core/SkRSXform.h"
+
+
+namespace Drawing {
+
+    /*
+     * Printable ASCII rendered once per font size into a white-on-transparent image. Glyphs are
+     * then drawn as tinted sprites with a single drawAtlas call rather than shaping a text blob
+     * per string. Atlases are cached per thread, keyed by typeface and font size.
+     */
+    class GlyphAtlas {
+    public:
+        static constexpr int firstChar = 32;
+        static constexpr int lastChar = 126;
+
+        sk_sp<SkImage> image;
+        std::array<SkRect, 128> tex{};      // cell of each glyph in the atlas image
+        std::array<SkPoint, 128> origin{};  // cell top-left relative to the pen position on the baseline
+        std::array<float, 128> advance{};
+
+        bool build(const SkFont &font);
+        bool has(char c) const { return c >= firstChar && c <= lastChar; }
+
+        static const GlyphAtlas *get(const SkFont &font);
+    };
+
+    /*
+     * Queue of text to be drawn in one go. On raster and GPU canvases glyphs are drawn from the atlas.
+     * Vector backends (pdf, svg, picture recording) have no pixel format, so text is drawn as real text.
+     * Glyphs are only drawn on flush, so draw order relative to other shapes is decided by the caller.
+     */
+    class GlyphBatch {
+    public:
+        GlyphBatch(SkCanvas *canvas, const SkFont &font);
+        ~GlyphBatch();
+
+        void add(char c, float x, float y, const SkPaint &paint);
+        void add(const char *text, float x, float y, const SkPaint &paint);
+        float measure(const char *text) const;
+        void flush();
+        bool empty() const { return xforms.empty() && pending.empty(); }
+
+    private:
+        struct PendingText {
+            std::string text;
+            float x, y;
+            SkColor color;
+        };
+        SkCanvas *canvas;
+        const SkFont &font;
+        const GlyphAtlas *atlas;
+        std::vector<SkRSXform> xforms;
+        std::vector<SkRect> rects;
+        std::vector<SkColor> colors;
+        std::vector<PendingText> pending;
+    };
+
+}
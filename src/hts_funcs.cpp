@@ -6,15 +6,20 @@
 #include <cctype>
 #include <chrono>
 #include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <future>
+#include <limits>
 #include <memory>
 #include <optional>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <unordered_map>
-#include <unordered_set>
 #include <vector>
 
+#include "htslib/bgzf.h"
 #include "htslib/hts.h"
 #include "htslib/sam.h"
 #include "htslib/tbx.h"
@@ -38,14 +43,6 @@ namespace {
         GTF,
     };
 
-    std::string stripQuotes(std::string value) {
-        Utils::trim(value);
-        if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
-            value = value.substr(1, value.size() - 2);
-        }
-        return value;
-    }
-
     std::unordered_map<std::string, std::string> parseTrackLabelRules(const std::string &rules) {
         std::unordered_map<std::string, std::string> parsed;
         for (auto item : Utils::split(rules, ';')) {
@@ -119,51 +116,6 @@ namespace {
         return false;
     }
 
-    std::string makeVariantSearchKey(const std::string &chrom, long start, const std::string &chrom2,
-                                     long stop, const std::string &rid) {
-        std::ostringstream ss;
-        ss << chrom << '\t' << start << '\t' << chrom2 << '\t' << stop << '\t' << rid;
-        return ss.str();
-    }
-
-    std::unordered_map<std::string, std::string> parseGffAttributes(const std::string &raw) {
-        std::unordered_map<std::string, std::string> attrs;
-        for (auto item : Utils::split(raw, ';')) {
-            Utils::trim(item);
-            if (item.empty()) {
-                continue;
-            }
-            auto eq = item.find('=');
-            if (eq == std::string::npos) {
-                continue;
-            }
-            std::string key = item.substr(0, eq);
-            std::string value = item.substr(eq + 1);
-            Utils::trim(key);
-            attrs[key] = stripQuotes(value);
-        }
-        return attrs;
-    }
-
-    std::unordered_map<std::string, std::string> parseGtfAttributes(const std::string &raw) {
-        std::unordered_map<std::string, std::string> attrs;
-        for (auto item : Utils::split(raw, ';')) {
-            Utils::trim(item);
-            if (item.empty()) {
-                continue;
-            }
-            auto ws = item.find_first_of(" \t");
-            if (ws == std::string::npos) {
-                continue;
-            }
-            std::string key = item.substr(0, ws);
-            std::string value = item.substr(ws + 1);
-            Utils::trim(key);
-            attrs[key] = stripQuotes(value);
-        }
-        return attrs;
-    }
-
     std::string getTrackLabelRuleForFormat(const std::string &rules, AnnotationLabelFormat format) {
         if (rules.empty()) {
             return "auto";
@@ -182,39 +134,11 @@ namespace {
         return (it == parsed.end() || it->second.empty()) ? "auto" : it->second;
     }
 
-    std::string firstAvailableAttr(const std::unordered_map<std::string, std::string> &attrs,
-                                   std::initializer_list<const char*> keys) {
-        for (const char *key : keys) {
-            auto it = attrs.find(key);
-            if (it != attrs.end() && !it->second.empty()) {
-                return it->second;
-            }
-        }
-        return "";
-    }
-
-    std::string resolveTrackLabel(const std::unordered_map<std::string, std::string> &attrs,
-                                  AnnotationLabelFormat format,
-                                  const std::string &rules) {
-        const std::string chosen = getTrackLabelRuleForFormat(rules, format);
-        if (chosen != "auto") {
-            auto it = attrs.find(chosen);
-            if (it != attrs.end() && !it->second.empty()) {
-                return it->second;
-            }
-        }
-        if (format == AnnotationLabelFormat::GTF) {
-            return firstAvailableAttr(attrs, {"gene_name", "gene_id", "transcript_id"});
-        }
-        return firstAvailableAttr(attrs, {"gene_name", "Name", "ID"});
-    }
-
-    // ---------- Fast-path helpers for the bulk GFF3/GTF non-indexed load ----------
+    // ---------- Fast-path helpers for GFF3/GTF parsing ----------
     // The non-indexed load reads the entire file into `allBlocks` — for a 2.2M-line
-    // GENCODE GFF3 the per-line cost dominates startup. The generic
-    // parseGff/GtfAttributes paths allocate a full unordered_map<string,string>
-    // and a vector<string> per line. The load only needs 3-4 specific keys, so
-    // we walk the attribute column once and copy only the values that match.
+    // GENCODE GFF3 the per-line cost dominates startup. Only 3-4 attribute keys are
+    // needed, so the attribute column is walked once and matching values are
+    // returned as views, without building a map or splitting into strings.
 
     static inline const char* skipWs(const char* p, const char* e) {
         while (p < e && (*p == ' ' || *p == '\t')) ++p;
@@ -229,12 +153,12 @@ namespace {
     }
 
     // Single-pass extractor for GFF3 attributes. Each out-param can be nullptr
-    // to skip. Stops scanning a key once it is filled.
-    static void extractGff3Attrs(const std::string &raw,
-                                 std::string *outId,
-                                 std::string *outName,
-                                 std::string *outParent,
-                                 std::string *outGeneName) {
+    // to skip. Stops scanning a key once it is filled. Outputs are views into raw.
+    static void extractGff3Attrs(std::string_view raw,
+                                 std::string_view *outId,
+                                 std::string_view *outName,
+                                 std::string_view *outParent,
+                                 std::string_view *outGeneName) {
         const char* p = raw.data();
         const char* e = p + raw.size();
         while (p < e) {
@@ -257,22 +181,22 @@ namespace {
                 return klen == litN && std::memcmp(a, lit, klen) == 0;
             };
             if (outId && outId->empty() && matches("ID", 2)) {
-                outId->assign(va, ve - va);
+                *outId = std::string_view(va, ve - va);
             } else if (outName && outName->empty() && matches("Name", 4)) {
-                outName->assign(va, ve - va);
+                *outName = std::string_view(va, ve - va);
             } else if (outParent && outParent->empty() && matches("Parent", 6)) {
-                outParent->assign(va, ve - va);
+                *outParent = std::string_view(va, ve - va);
             } else if (outGeneName && outGeneName->empty() && matches("gene_name", 9)) {
-                outGeneName->assign(va, ve - va);
+                *outGeneName = std::string_view(va, ve - va);
             }
         }
     }
 
     // Single-pass extractor for GTF attributes (key "value" pairs).
-    static void extractGtfAttrs(const std::string &raw,
-                                std::string *outGeneId,
-                                std::string *outGeneName,
-                                std::string *outTranscriptId) {
+    static void extractGtfAttrs(std::string_view raw,
+                                std::string_view *outGeneId,
+                                std::string_view *outGeneName,
+                                std::string_view *outTranscriptId) {
         const char* p = raw.data();
         const char* e = p + raw.size();
         while (p < e) {
@@ -294,18 +218,18 @@ namespace {
                 return klen == litN && std::memcmp(a, lit, klen) == 0;
             };
             if (outGeneId && outGeneId->empty() && matches("gene_id", 7)) {
-                outGeneId->assign(va, ve - va);
+                *outGeneId = std::string_view(va, ve - va);
             } else if (outGeneName && outGeneName->empty() && matches("gene_name", 9)) {
-                outGeneName->assign(va, ve - va);
+                *outGeneName = std::string_view(va, ve - va);
             } else if (outTranscriptId && outTranscriptId->empty() && matches("transcript_id", 13)) {
-                outTranscriptId->assign(va, ve - va);
+                *outTranscriptId = std::string_view(va, ve - va);
             }
         }
     }
 
     // GFF3 label resolution that mirrors resolveTrackLabel but never builds a map.
-    static std::string resolveGff3LabelFast(const std::string &attrsRaw,
-                                            const std::string &chosen) {
+    static std::string_view resolveGff3LabelFast(std::string_view attrsRaw,
+                                                 const std::string &chosen) {
         if (chosen != "auto") {
             const char* p = attrsRaw.data();
             const char* e = p + attrsRaw.size();
@@ -327,11 +251,11 @@ namespace {
                     const char* va = skipWs(eq + 1, b);
                     const char* ve = b;
                     stripQuotesView(va, ve);
-                    if (va != ve) return std::string(va, ve - va);
+                    if (va != ve) return std::string_view(va, ve - va);
                 }
             }
         }
-        std::string id, name, geneName;
+        std::string_view id, name, geneName;
         extractGff3Attrs(attrsRaw, &id, &name, /*parent=*/nullptr, &geneName);
         if (!geneName.empty()) return geneName;
         if (!name.empty())     return name;
@@ -339,8 +263,8 @@ namespace {
     }
 
     // GTF label resolution.
-    static std::string resolveGtfLabelFast(const std::string &attrsRaw,
-                                           const std::string &chosen) {
+    static std::string_view resolveGtfLabelFast(std::string_view attrsRaw,
+                                                const std::string &chosen) {
         if (chosen != "auto") {
             const char* p = attrsRaw.data();
             const char* e = p + attrsRaw.size();
@@ -362,36 +286,398 @@ namespace {
                     const char* va = skipWs(ws + 1, b);
                     const char* ve = b;
                     stripQuotesView(va, ve);
-                    if (va != ve) return std::string(va, ve - va);
+                    if (va != ve) return std::string_view(va, ve - va);
                 }
             }
         }
-        std::string geneId, geneName, transcriptId;
+        std::string_view geneId, geneName, transcriptId;
         extractGtfAttrs(attrsRaw, &geneId, &geneName, &transcriptId);
         if (!geneName.empty())   return geneName;
         if (!geneId.empty())     return geneId;
         return transcriptId;
     }
 
-    // In-place tab split: writes column [start,end) offsets into `colStart` /
-    // `colEnd` arrays. Returns the column count. No allocations.
-    static int splitTabsInPlace(const std::string &line,
-                                size_t *colStart, size_t *colEnd, int maxCols) {
-        int n = 0;
-        size_t i = 0, L = line.size();
-        if (maxCols > 0) colStart[0] = 0;
-        while (i <= L && n < maxCols) {
-            if (i == L || line[i] == '\t') {
-                colEnd[n] = i;
-                ++n;
-                if (i == L) break;
-                if (n < maxCols) colStart[n] = i + 1;
-                ++i;
+    // Parent, id and label of a GFF3/GTF record, as views into its attribute column. Shared by the
+    // bulk non-indexed load and the tabix iterator so both resolve names identically
+    struct AnnotationAttrs {
+        std::string_view name, parent, uniqueId;
+    };
+
+    static AnnotationAttrs resolveAnnotationAttrs(std::string_view attrsRaw, bool gtf, const std::string &chosenLabelKey) {
+        AnnotationAttrs out;
+        if (!gtf) {
+            std::string_view name, geneName;
+            extractGff3Attrs(attrsRaw, &out.uniqueId, &name, &out.parent, &geneName);
+            if (chosenLabelKey != "auto") {
+                out.name = resolveGff3LabelFast(attrsRaw, chosenLabelKey);
+            } else {
+                if (!geneName.empty())          out.name = geneName;
+                else if (!name.empty())         out.name = name;
+                else                            out.name = out.uniqueId;
+            }
+        } else {
+            std::string_view geneId, geneName, transcriptId;
+            extractGtfAttrs(attrsRaw, &geneId, &geneName, &transcriptId);
+            // Preserve old last-wins precedence: gene_id, then gene_name
+            // overwrites, then transcript_id overwrites.
+            if (!geneId.empty())       out.parent = geneId;
+            if (!geneName.empty())     out.parent = geneName;
+            if (!transcriptId.empty()) out.parent = transcriptId;
+            if (chosenLabelKey != "auto") {
+                out.name = resolveGtfLabelFast(attrsRaw, chosenLabelKey);
             } else {
-                ++i;
+                if (!geneName.empty())          out.name = geneName;
+                else if (!geneId.empty())       out.name = geneId;
+                else                            out.name = transcriptId;
+            }
+        }
+        return out;
+    }
+
+    // Records are merged in file order. Consecutive records are nearly always on the same
+    // chromosome, so the map is only searched when the chromosome changes
+    class BlockAppender {
+    public:
+        BlockAppender(ankerl::unordered_dense::map<std::string, SuperIntervals<int, HGW::FeatureRecord>> &blocks,
+                      const HGW::FeatureStore &store)
+            : blocks(blocks), store(store) {}
+
+        void add(const HGW::FeatureRecord &r) {
+            if (current == nullptr || r.chrom != currentId) {
+                currentId = r.chrom;
+                current = &blocks[std::string(store.str(currentId))];
+            }
+            current->add(r.start, r.end, r);
+        }
+
+    private:
+        ankerl::unordered_dense::map<std::string, SuperIntervals<int, HGW::FeatureRecord>> &blocks;
+        const HGW::FeatureStore &store;
+        SuperIntervals<int, HGW::FeatureRecord> *current{nullptr};
+        uint32_t currentId{0};
+    };
+
+    // Features parsed from one newline-aligned byte range of a non-indexed track. Each range has
+    // its own store so that ranges can be parsed on separate threads, then merged in file order
+    struct TrackChunk {
+        HGW::FeatureStore store;
+        std::vector<HGW::FeatureRecord> records;
+        std::vector<size_t> unnamed;  // BED records without a name column, numbered when merged
+        std::vector<std::pair<int, std::string>> warnings;  // line number within the chunk, or -1
+        int lines{0};
+    };
+
+    // Approximate memory held by a cached window, for WindowCache accounting
+    size_t windowBytes(const HGW::FeatureWindow &fw) {
+        return fw.store->textBytes() + fw.blocks.data.size() * (sizeof(HGW::FeatureRecord) + 2 * sizeof(int) + sizeof(size_t));
+    }
+
+    size_t windowBytes(const bwOverlappingIntervals_t *iv) {
+        if (iv == nullptr) {
+            return 0;
+        }
+        return (size_t)iv->l * (((iv->end) ? 2 : 1) * sizeof(uint32_t) + sizeof(float));
+    }
+
+    // Plain-text tracks smaller than this are parsed on the calling thread
+    constexpr uint64_t minChunkBytes = 32ULL << 20;
+
+    // Start offsets of at most maxChunks newline-aligned ranges of a local file, plus the file size. Returns
+    // an empty vector if the file is small or remote, in which case it is read as one stream
+    std::vector<uint64_t> trackChunkBounds(const std::string &path, uint64_t maxChunks) {
+        std::vector<uint64_t> bounds;
+#if !defined(__EMSCRIPTEN__)
+        if (Utils::startsWith(path, "http") || Utils::startsWith(path, "ftp")) {
+            return bounds;
+        }
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        if (!in.is_open()) {
+            return bounds;
+        }
+        const auto size = (uint64_t)in.tellg();
+        const uint64_t n = std::min(maxChunks, size / minChunkBytes);
+        if (n < 2) {
+            return bounds;
+        }
+        bounds.push_back(0);
+        for (uint64_t i = 1; i < n; ++i) {
+            in.clear();
+            in.seekg((std::streamoff)(size / n * i));
+            in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            const auto pos = (in.good()) ? (uint64_t)in.tellg() : size;
+            if (pos > bounds.back() && pos < size) {
+                bounds.push_back(pos);
+            }
+        }
+        bounds.push_back(size);
+#endif
+        return bounds;
+    }
+
+    // Writes the indexed copy of a plain VCF (see HGW::indexedVcfCopyPath) as its lines are read. Records
+    // that are not sorted cannot be indexed, so the copy is dropped as soon as one is seen
+    class VcfCopyWriter {
+    public:
+        VcfCopyWriter(const std::string &sourcePath, const std::string &copyPath, const bcf_hdr_t *hdr)
+            : copyPath(copyPath), tmpPath(copyPath + ".tmp") {
+            std::error_code ec;
+            std::filesystem::create_directories(std::filesystem::path(copyPath).parent_path(), ec);
+            const std::string key = HGW::indexedVcfCopyKey(sourcePath);
+            bcf_hdr_t *outHdr = bcf_hdr_dup(hdr);
+            kstring_t text = {0, 0, nullptr};
+            if (!ec && !key.empty() && outHdr && bcf_hdr_append(outHdr, ("##gwSource=" + key).c_str()) == 0 &&
+                bcf_hdr_format(outHdr, 0, &text) == 0) {
+                out = bgzf_open(tmpPath.c_str(), "w");
+                if (out && bgzf_write(out, text.s, text.l) < 0) {
+                    abandon();
+                }
+            }
+            free(text.s);
+            if (outHdr) {
+                bcf_hdr_destroy(outHdr);
+            }
+        }
+        ~VcfCopyWriter() {
+            abandon();
+        }
+
+        // Called before vcf_parse, which splits the line in place
+        void add(const kstring_t &line) {
+            if (out && (bgzf_write(out, line.s, line.l) < 0 || bgzf_write(out, "\n", 1) < 0)) {
+                abandon();
+            }
+        }
+
+        void checkSorted(int rid, int64_t pos) {
+            if (rid != lastRid) {
+                if (!seenRids.insert(rid).second) {
+                    abandon();
+                }
+                lastRid = rid;
+            } else if (pos < lastPos) {
+                abandon();
+            }
+            lastPos = pos;
+        }
+
+        void finish() {
+            if (!out) {
+                return;
+            }
+            const int closed = bgzf_close(out);
+            out = nullptr;
+            if (closed != 0 || tbx_index_build(tmpPath.c_str(), 14, &tbx_conf_vcf) != 0) {  // min_shift > 0 builds a CSI index
+                abandon();
+                return;
+            }
+            // Replaced under temporary names, so a reader never opens a partial copy
+            std::error_code ec;
+            std::filesystem::remove(copyPath + ".csi", ec);
+            std::filesystem::rename(tmpPath, copyPath, ec);
+            if (!ec) {
+                std::filesystem::rename(tmpPath + ".csi", copyPath + ".csi", ec);
+            }
+            if (ec) {
+                std::filesystem::remove(copyPath, ec);
+                abandon();
+                return;
+            }
+            HGW::trimIndexedVcfCopies(copyPath);
+        }
+
+    private:
+        std::string copyPath, tmpPath;
+        BGZF *out{nullptr};
+        ankerl::unordered_dense::set<int> seenRids;
+        int lastRid{-1};
+        int64_t lastPos{0};
+
+        void abandon() {
+            if (out) {
+                bgzf_close(out);
+                out = nullptr;
+            }
+            std::error_code ec;
+            std::filesystem::remove(tmpPath, ec);
+            std::filesystem::remove(tmpPath + ".csi", ec);
+        }
+    };
+
+    // Positions a PAF line on its target (columns 6, 8 and 9), or on its query (columns 1, 3 and 4) for
+    // files indexed by query coordinates. name is the sequence on the other side of the alignment
+    bool parsePafLine(std::string_view line, bool byQuery, std::string_view &chrom, int &start, int &end,
+                      std::string_view &name, int &strand) {
+        std::string_view cols[9];
+        if (Utils::splitView(line, '\t', cols, 9, true) < 9) {
+            return false;
+        }
+        const int c = (byQuery) ? 0 : 5;
+        if (!Utils::parseInt(cols[c + 2], start) || !Utils::parseInt(cols[c + 3], end)) {
+            return false;
+        }
+        chrom = cols[c];
+        name = cols[(byQuery) ? 5 : 0];
+        strand = (cols[4] == "+") ? 1 : 2;
+        return true;
+    }
+
+    // Parses lines of a BED, label, PAF, GFF3 or GTF file until length bytes have been read
+    void parseTrackChunk(std::istream &in, uint64_t length, HGW::FType kind, const std::string &path,
+                         const std::string &labelKey, TrackChunk &out) {
+        HGW::FeatureStore &store = out.store;
+        const bool gtf = kind == HGW::GTF_NOI;
+        std::string tp;
+        std::string chrom;
+        uint32_t chromId = 0;
+        uint64_t consumed = 0;
+        auto warn = [&](const char *msg) {
+            out.warnings.emplace_back(-1, std::string(msg) + path + ": " + tp);
+        };
+        while (consumed < length && std::getline(in, tp)) {
+            consumed += tp.size() + 1;
+            out.lines += 1;
+            if (tp.empty() || tp[0] == '#') {
+                continue;
+            }
+            HGW::FeatureRecord r{};
+            std::string_view chromView;
+            if (kind == HGW::BED_NOI || kind == HGW::GW_LABEL) {
+                std::string_view cols[6];
+                const int nCols = Utils::splitView(tp, '\t', cols, 6, true);
+                if (nCols < 2 || !Utils::parseInt(cols[1], r.start)) {
+                    warn("Warning: skipping malformed line in ");
+                    continue;
+                }
+                if (kind == HGW::BED_NOI) {  // bed
+                    if (nCols < 3 || !Utils::parseInt(cols[2], r.end)) {
+                        warn("Warning: skipping malformed BED line in ");
+                        continue;
+                    }
+                    r.line = store.addText(tp);
+                    if (nCols > 3) {
+                        r.name = HGW::FeatureStore::subText(r.line, tp, cols[3]);
+                        if (nCols >= 6) {
+                            if (cols[5] == "+") {
+                                r.strand = 1;
+                            } else if (cols[5] == "-") {
+                                r.strand = 2;
+                            }
+                        }
+                    } else {
+                        out.unnamed.push_back(out.records.size());
+                    }
+                } else { // assume gw_label file
+                    r.end = r.start + 1;
+                    r.line = store.addText(tp);
+                }
+                chromView = cols[0];
+            } else if (kind == HGW::PAF_NOI) {
+                std::string_view name;
+                if (!parsePafLine(tp, false, chromView, r.start, r.end, name, r.strand)) {
+                    warn("Warning: skipping malformed PAF line in ");
+                    continue;
+                }
+                r.line = store.addText(tp);
+                r.name = HGW::FeatureStore::subText(r.line, tp, name);
+            } else {  // GFF3_NOI or GTF_NOI
+                std::string_view cols[9];
+                const int nCols = Utils::splitView(tp, '\t', cols, 9, false);
+                if (nCols < 9) {
+                    out.warnings.emplace_back(out.lines, "Error: parsing file, not enough columns in line split by tab. n columns = "
+                                              + std::to_string(nCols) + ", line was: " + tp);
+                    continue;
+                }
+                // GTF_NOI: only "exon" rows are kept. Check before any allocation.
+                if (gtf && cols[2] != "exon") {
+                    continue;
+                }
+                if (!Utils::parseInt(cols[3], r.start) || !Utils::parseInt(cols[4], r.end)) {
+                    warn("Warning: skipping malformed line in ");
+                    continue;
+                }
+                const AnnotationAttrs attrs = resolveAnnotationAttrs(cols[8], gtf, labelKey);
+                if (attrs.name.empty()) {
+                    continue;
+                }
+                r.start -= 1;
+                r.strand = (cols[6] == "+") ? 1 : ((cols[6] == "-") ? 2 : 0);
+                r.vartype = store.intern(cols[2]);
+                // Parents are interned by name, so children in different chunks still group together
+                r.parent = store.intern(attrs.parent);
+                // Names and ids are views into the attribute column, so they reference the stored line
+                r.line = store.addText(tp);
+                r.name = HGW::FeatureStore::subText(r.line, tp, attrs.name);
+                if (!gtf) {
+                    r.uniqueId = HGW::FeatureStore::subText(r.line, tp, attrs.uniqueId);
+                }
+                chromView = cols[0];
             }
+            if (out.records.empty() || chromView != chrom) {
+                chrom = chromView;
+                chromId = store.intern(chrom);
+            }
+            r.chrom = chromId;
+            out.records.push_back(r);
+        }
+    }
+
+    // Offset of the record that the next read of fp returns: a virtual offset for BGZF files (.vcf.gz, .bcf),
+    // a byte offset for plain text. -1 if fp cannot be seeked, e.g. gzip or a stream
+    int64_t recordOffset(htsFile *fp) {
+        if (fp->format.compression == bgzf) {
+            return bgzf_tell(fp->fp.bgzf);
+        }
+        if (fp->format.compression == no_compression && !fp->is_bgzf) {
+            return (int64_t)htell(fp->fp.hfile);
+        }
+        return -1;
+    }
+
+    bool seekRecord(htsFile *fp, int64_t offset) {
+        if (offset < 0) {
+            return false;
+        }
+        if (fp->format.compression == bgzf) {
+            return bgzf_seek(fp->fp.bgzf, offset, SEEK_SET) == 0;
+        }
+        if (fp->format.compression == no_compression && !fp->is_bgzf) {
+            return hseek(fp->fp.hfile, (off_t)offset, SEEK_SET) == (off_t)offset;
+        }
+        return false;
+    }
+
+    // Offset of every record of a VCF/BCF, in file order, read with a reader of its own. Empty if the
+    // file cannot be opened or seeked, or if cancel is set before the end
+    std::vector<int64_t> scanRecordOffsets(const std::string &path, const std::atomic<bool> &cancel) {
+        std::vector<int64_t> offsets;
+        htsFile *fp = bcf_open(path.c_str(), "r");
+        if (!fp) {
+            return offsets;
+        }
+        bcf_hdr_t *hdr = bcf_hdr_read(fp);
+        bcf1_t *v = bcf_init1();
+        if (hdr && v) {
+            v->max_unpack = BCF_UN_STR;  // only the fixed columns are needed to step over a record
+            while (true) {
+                const int64_t offset = recordOffset(fp);
+                if (offset < 0 || cancel.load(std::memory_order_relaxed)) {
+                    offsets.clear();
+                    break;
+                }
+                if (bcf_read(fp, hdr, v) < 0) {
+                    break;
+                }
+                offsets.push_back(offset);
+            }
+        }
+        if (v) {
+            bcf_destroy1(v);
         }
-        return n;
+        if (hdr) {
+            bcf_hdr_destroy(hdr);
+        }
+        bcf_close(fp);
+        return offsets;
     }
 
 } // namespace
@@ -643,6 +929,29 @@ namespace HGW {
         col.collection_processed = false;
     }
 
+    void collectWindowReadsAndCoverage(Segs::ReadCollection &col, const Segs::ReadCollection &window, sam_hdr_t *hdr_ptr,
+                                       Utils::Region *region, bool coverage, std::vector<Parse::Parser> &filters) {
+        if (region == nullptr || region->end <= region->start) {
+            return;
+        }
+        std::vector<Segs::Align>& readQueue = col.readQueue;
+        for (const auto &a : window.readQueue) {
+            // the reads an index query of region returns
+            if (a.delegate->core.pos < region->end && bam_endpos(a.delegate) > region->start) {
+                readQueue.push_back(a);  // copies the record, the window keeps its own
+            }
+        }
+        if (!filters.empty()) {
+            applyFilters(filters, readQueue, hdr_ptr, col.bamIdx, col.regionIdx);
+        }
+        if (coverage) {
+            for (auto &i : readQueue) {
+                Segs::addToCovArray(col.covArr, i, region->start, region->end);
+            }
+        }
+        col.collection_processed = false;
+    }
+
     // WIP, still running in to segfaults strlen? Not sure what is causing it
 
 //    void iterDrawParallel(Segs::ReadCollection &col,
@@ -1485,6 +1794,14 @@ namespace HGW {
         }
     }
 
+    bool VCFfile::seek(int64_t offset) {
+        if (!fp || cacheStdin || !seekRecord(fp, offset)) {
+            return false;
+        }
+        done = false;
+        return true;
+    }
+
 	void VCFfile::printTargetRecord(std::string &id_str, std::string &chrom, int pos) {
         if (kind == BCF_IDX) {
             return print_BCF_IDX(idx_v, hdr, chrom, pos, fp, id_str, variantString);
@@ -1631,35 +1948,18 @@ namespace HGW {
         if (kstr.s) free(kstr.s);
 	}
 
-	void print_cached(std::vector<Utils::TrackBlock> &vals, std::string &chrom, int pos, bool flat, std::string &variantString) {
-		auto vals_end = vals.end();
-		std::vector<Utils::TrackBlock>::iterator iter_blk;
-		if (flat) {
-			iter_blk = vals.begin();
-		} else {
-			iter_blk = std::lower_bound(vals.begin(), vals.end(), pos,
-			                            [](Utils::TrackBlock &a, int x)-> bool { return a.start < x;});
-			if (iter_blk != vals.begin()) {
-				--iter_blk;
-			}
+	void print_cached(const std::vector<FeatureRecord> &vals, const FeatureStore &store, int pos, std::string &variantString) {
+		auto iter_blk = std::lower_bound(vals.begin(), vals.end(), pos,
+		                                 [](const FeatureRecord &a, int x)-> bool { return a.start < x;});
+		if (iter_blk != vals.begin()) {
+			--iter_blk;
 		}
-		while (true) {
-			if (iter_blk == vals_end) {
+		while (iter_blk != vals.end()) {
+			if (iter_blk->start <= pos && iter_blk->end > pos) {
+				variantString = store.text(iter_blk->line);
+			} else if (iter_blk->start > pos) {
 				break;
 			}
-			if (flat && iter_blk->chrom == chrom) {
-				if (iter_blk->start <= pos && iter_blk->end > pos) {
-					variantString = iter_blk->line;
-				} else if (iter_blk->start > pos) {
-					break;
-				}
-			} else {
-				if (iter_blk->start <= pos && iter_blk->end > pos) {
-					variantString = iter_blk->line;
-				} else if (iter_blk->start > pos) {
-					break;
-				}
-			}
 			iter_blk++;
 		}
 	}
@@ -1687,98 +1987,544 @@ namespace HGW {
     void GwTrack::close() {
         if ((kind == BIGWIG || kind == BIGBED) && bigWig_fp) {
             bwClose(bigWig_fp);
-            if (kind == BIGWIG) {
-                bwDestroyOverlappingIntervals(bigWig_intervals);
-            } else {
-                bbDestroyOverlappingEntries(bigBed_entries);
-            }
+            bigWig_intervals = nullptr;
+            bigWigCache.clear();
         }
     }
 
     void GwTrack::clear() {
-        allBlocks_flat.clear();
+        resetFetched();
+        fetchCache.clear();
         allBlocks.clear();
+        sharedBlocks.reset();
+        store.reset();
+        mappedBlocks.reset();
+        nameIndex.reset();
     }
 
-    void GwTrack::parseVcfRecord(Utils::TrackBlock &b) {
-        kstring_t kstr = {0,0,0};
-        bcf_unpack(v, BCF_UN_INFO);
-        vcf_format(hdr, v, &kstr);
-        b.line = kstr.s;
-        b.chrom = bcf_hdr_id2name(hdr, v->rid);
-        b.start = (int)v->pos;
-        b.end = b.start + v->rlen;
-        b.name = v->d.id;
-        switch (bcf_get_variant_types(v)) {
-            case VCF_SNP: b.vartype = "SNP"; break;
-            case VCF_INDEL: b.vartype = "INDEL"; break;
-            case VCF_OVERLAP: b.vartype = "OVERLAP"; break;
-            case VCF_BND: b.vartype = "BND"; break;
-            case VCF_OTHER: b.vartype = "OTHER"; break;
-            case VCF_MNP: b.vartype = "MNP"; break;
-            default: b.vartype = "REF";
+    std::shared_ptr<const GwTrack::SharedBlocks> GwTrack::shareBlocks() {
+        if (sharedBlocks || !add_to_dict || !store || mappedBlocks || !isNonIndexed(kind) ||
+            kind == ROI || kind == INTRON || kind == STDIN) {  // ROI and INTRON tracks are still added to
+            return sharedBlocks;
         }
-        bcf_info_t * info_field = bcf_get_info(hdr, v, "SVTYPE");  // try and find chrom2 in info
-        if (info_field != nullptr) {
-            char *svtmem = nullptr;
-            int mem = 0;
-            int resc = bcf_get_info_string(hdr, v, "SVTYPE", &svtmem,&mem);
-            if (resc < 0) {
-            } else {
-                b.vartype = svtmem;
-            }
-            free(svtmem);
+        resetFetched();
+        auto shared = std::make_shared<SharedBlocks>();
+        shared->blocks = std::move(allBlocks);
+        shared->store = store;
+        allBlocks.clear();
+        sharedBlocks = std::move(shared);
+        return sharedBlocks;
+    }
+
+    void GwTrack::openLoaded(const std::string &p, FType k, std::shared_ptr<const SharedBlocks> shared,
+                             std::shared_ptr<MappedTrackFile> mapped) {
+        fileIndex = 0;
+        path = p;
+        kind = k;
+        add_to_dict = true;
+        done = true;
+        clear();
+        if (shared) {
+            store = shared->store;
+            sharedBlocks = std::move(shared);
+        } else if (mapped) {
+            mappedBlocks = std::move(mapped);
+            store = std::make_shared<FeatureStore>();
+            mappedBlocks->attach(*store);
         }
-        free(kstr.s);
     }
 
-    void GwTrack::parseVcfRecord() {
-//        bcf_unpack(v, BCF_UN_INFO);
-        kstring_t kstr = {0,0,0};
-        bcf_unpack(v, BCF_UN_INFO);
-        vcf_format(hdr, v, &kstr);
-        variantString = kstr.s;
+    // Adding a chromosome to allBlocks can move the other entries, so any fetch in progress is dropped
+    void GwTrack::resetFetched() {
+        overlappingBlocks.clear();
+        fetchedBlocks = nullptr;
+        iter_blk = overlappingBlocks.crend();
+        vals_end = overlappingBlocks.crend();
+    }
 
-        chrom = bcf_hdr_id2name(hdr, v->rid);
-        start = (int)v->pos;
-        stop = (int)start + v->rlen;
-        rid = v->d.id;
-        switch (bcf_get_variant_types(v)) {
-            case VCF_SNP: vartype = "SNP"; break;
-            case VCF_INDEL: vartype = "INDEL"; break;
-            case VCF_OVERLAP: vartype = "OVERLAP"; break;
-            case VCF_BND: vartype = "BND"; break;
-            case VCF_OTHER: vartype = "OTHER"; break;
-            case VCF_MNP: vartype = "MNP"; break;
-            default: vartype = "REF";
+    void GwTrack::addBlock(const Utils::TrackBlock &b) {
+        if (!store) {
+            store = std::make_shared<FeatureStore>();
         }
-        bcf_info_t * info_field = bcf_get_info(hdr, v, "SVTYPE");  // try and find chrom2 in info
-        if (info_field != nullptr) {
-            char *svtmem = nullptr;
-            int mem = 0;
-            int resc = bcf_get_info_string(hdr, v, "SVTYPE", &svtmem,&mem);
-            if (resc < 0) {
-            } else {
-                vartype = svtmem;
-            }
-            free(svtmem);
+        if (fetchedBlocks != nullptr) {
+            resetFetched();
         }
-        free(kstr.s);
+        nameIndex.reset();
+        allBlocks[b.chrom].add(b.start, b.end, store->makeRecord(b));
     }
 
-    void GwTrack::setPaint(SkPaint &faceColour) {
-        this->faceColour = faceColour;
-        this->faceColour.setAntiAlias(true);
-        this->shadedFaceColour.setAntiAlias(true);
-        int c = faceColour.getColor();
-        this->shadedFaceColour.setARGB(faceColour.getAlpha() * 0.5, SkColorGetR(c), SkColorGetG(c), SkColorGetB(c));
+    bool GwTrack::openCachedBlocks() {
+        mappedBlocks = MappedTrackFile::open(path, (int)kind, track_label_parser_rules);
+        if (!mappedBlocks) {
+            return false;
+        }
+        store = std::make_shared<FeatureStore>();
+        mappedBlocks->attach(*store);
+        done = true;
+        return true;
     }
 
-    void GwTrack::open(const std::string &p, bool add_to_dict=true) {
-        fileIndex = 0;
-        path = p;
-        done = false;
-        this->add_to_dict = add_to_dict;
+    bool GwTrack::openIndexedVcfCopy() {
+        const std::string copyPath = indexedVcfCopyPath(path);
+        std::error_code ec;
+        if (copyPath.empty() || !std::filesystem::exists(copyPath + ".csi", ec)) {
+            return false;
+        }
+        htsFile *copyFp = bcf_open(copyPath.c_str(), "r");
+        bcf_hdr_t *copyHdr = (copyFp) ? bcf_hdr_read(copyFp) : nullptr;
+        bcf_hrec_t *key = (copyHdr) ? bcf_hdr_get_hrec(copyHdr, BCF_HL_GEN, "gwSource", nullptr, nullptr) : nullptr;
+        tbx_t *copyIdx = (key && key->value && indexedVcfCopyKey(path) == key->value)
+                         ? tbx_index_load2(copyPath.c_str(), (copyPath + ".csi").c_str()) : nullptr;
+        if (!copyIdx) {  // stale or unreadable, rewritten when the source is read
+            if (copyHdr) {
+                bcf_hdr_destroy(copyHdr);
+            }
+            if (copyFp) {
+                hts_close(copyFp);
+            }
+            return false;
+        }
+        touchIndexedVcfCopy(copyPath);
+        kind = VCF_IDX;
+        indexedCopy = copyPath;
+        fp = copyFp;
+        hdr = copyHdr;
+        idx_t = copyIdx;
+        v = bcf_init1();
+        v->max_unpack = BCF_UN_INFO;
+        return true;
+    }
+
+    void GwTrack::saveCachedBlocks() {
+        MappedTrackFile::write(path, (int)kind, track_label_parser_rules, allBlocks, *store);
+    }
+
+    void GwTrack::loadBlocks(BS::thread_pool *pool) {
+        const std::string labelKey = (kind == GFF3_NOI || kind == GTF_NOI)
+            ? getTrackLabelRuleForFormat(track_label_parser_rules,
+                                         (kind == GTF_NOI) ? AnnotationLabelFormat::GTF : AnnotationLabelFormat::GFF3)
+            : std::string();
+        const std::vector<uint64_t> bounds = (pool) ? trackChunkBounds(path, pool->get_thread_count()) : std::vector<uint64_t>();
+        std::vector<TrackChunk> chunks;
+        if (bounds.size() > 2) {
+            chunks.resize(bounds.size() - 1);
+            pool->parallelize_loop(0, chunks.size(),
+                                   [&](const size_t a, const size_t b) {
+                                       for (size_t i = a; i < b; ++i) {
+                                           std::vector<char> buffer(1 << 20);
+                                           std::ifstream in;
+                                           in.rdbuf()->pubsetbuf(buffer.data(), (std::streamsize)buffer.size());
+                                           in.open(path, std::ios::binary);
+                                           in.seekg((std::streamoff)bounds[i]);
+                                           parseTrackChunk(in, bounds[i + 1] - bounds[i], kind, path, labelKey, chunks[i]);
+                                       }
+                                   }).wait();
+        } else {
+            chunks.resize(1);
+            parseTrackChunk(*fpu, std::numeric_limits<uint64_t>::max(), kind, path, labelKey, chunks[0]);
+        }
+
+        BlockAppender blocks(allBlocks, *store);
+        int lineOffset = 0;
+        for (auto &c : chunks) {
+            for (const auto &w : c.warnings) {
+                std::cerr << w.second;
+                if (w.first >= 0) {
+                    std::cerr << ", at file index " << lineOffset + w.first;
+                }
+                std::cerr << std::endl;
+            }
+            const FeatureStore::Rebase rebase = store->absorb(std::move(c.store));
+            auto unnamed = c.unnamed.begin();
+            for (size_t i = 0; i < c.records.size(); ++i) {
+                FeatureRecord &r = c.records[i];
+                rebase.apply(r);
+                if (unnamed != c.unnamed.end() && *unnamed == i) {
+                    r.name = store->addText(std::to_string(fileIndex));
+                    fileIndex += 1;
+                    ++unnamed;
+                }
+                blocks.add(r);
+            }
+            lineOffset += c.lines;
+            c = TrackChunk();
+        }
+
+        if (pool && allBlocks.size() > 1) {
+            pool->parallelize_loop(0, allBlocks.size(),
+                                   [&](const size_t a, const size_t b) {
+                                       for (size_t i = a; i < b; ++i) {
+                                           (allBlocks.begin() + (std::ptrdiff_t)i)->second.index();
+                                       }
+                                   }).wait();
+        } else {
+            for (auto &item : allBlocks) {
+                item.second.index();
+            }
+        }
+        done = true;
+        saveCachedBlocks();
+    }
+
+    void GwTrack::loadCachedChrom(const std::string &chrom) {
+        if (!mappedBlocks || allBlocks.contains(chrom) || !mappedBlocks->contains(chrom)) {
+            return;
+        }
+        resetFetched();
+        mappedBlocks->load(chrom, allBlocks[chrom], *store);
+    }
+
+    void GwTrack::fetchWindow(const Utils::Region *rgn) {
+        // GFF is padded so that transcripts crossing the edges of the view are complete
+        const bool gff = kind == GFF3_IDX || kind == GTF_IDX;
+        const int qStart = (gff) ? std::max(1, rgn->start - 100000) : ((kind == BIGBED) ? std::max(1, rgn->start) : rgn->start);
+        const int qEnd = (gff) ? rgn->end + 100000 : rgn->end;
+        resetFetched();
+        auto *w = fetchCache.find(rgn->chrom, qStart, qEnd);
+        if (w == nullptr) {
+            const int slack = (qEnd - qStart) / 2;
+            const int wStart = std::max((kind == BIGBED) ? 1 : 0, qStart - slack);
+            const int wEnd = qEnd + slack;
+            if (loader) {
+                loader->request(*this, rgn->chrom, wStart, wEnd);
+                loading = true;
+                done = true;
+                return;
+            }
+            FeatureWindow fw = readWindow(rgn->chrom, wStart, wEnd);
+            const size_t bytes = windowBytes(fw);
+            w = &fetchCache.insert(rgn->chrom, wStart, wEnd, bytes, std::move(fw));
+        }
+        store = w->value.store;
+        fetchedBlocks = &w->value.blocks;
+        // Index queries are half open, SuperIntervals compares closed intervals
+        w->value.blocks.findIndexes(qStart + 1, std::max(qStart + 1, qEnd - 1), overlappingBlocks);
+        if (overlappingBlocks.empty()) {
+            done = true;
+            return;
+        }
+        done = false;
+        fetch_start = rgn->start;
+        fetch_end = rgn->end;
+        iter_blk = overlappingBlocks.crbegin();
+        vals_end = overlappingBlocks.crend();
+    }
+
+    // Reads every record of an indexed track overlapping [windowStart, windowEnd). Tabix and BCF
+    // records go through next(), with the VCF distance filter switched off, as next() applies it
+    // again when the window is served for a region
+    FeatureWindow GwTrack::readWindow(const std::string &windowChrom, int windowStart, int windowEnd) {
+        FeatureWindow fw;
+        fw.store = std::make_shared<FeatureStore>();
+        FeatureStore &st = *fw.store;
+        if (kind == BIGBED) {
+            bbOverlappingEntries_t *entries = bbGetOverlappingEntries(bigWig_fp, windowChrom.c_str(), (uint32_t)windowStart, (uint32_t)windowEnd, 1);
+            if (entries == nullptr) {
+                return fw;
+            }
+            const uint32_t chromId = st.intern(windowChrom);
+            for (uint32_t i = 0; i < entries->l; ++i) {
+                FeatureRecord r{};
+                r.start = (int)entries->start[i];
+                r.end = (int)entries->end[i];
+                r.chrom = chromId;
+                if (entries->str != nullptr) {  // columns after chrom, start and end; the first is the name
+                    const std::string_view rest(entries->str[i]);
+                    r.line = st.addText(rest);
+                    r.name = FeatureStore::subText(r.line, rest, rest.substr(0, rest.find('\t')));
+                }
+                fw.blocks.add(r.start, r.end, r);
+            }
+            bbDestroyOverlappingEntries(entries);
+            fw.blocks.index();
+            return fw;
+        }
+        if (kind == BCF_IDX) {
+            const int tid = bcf_hdr_name2id(hdr, windowChrom.c_str());
+            iter_q = (tid < 0) ? nullptr : bcf_itr_queryi(idx_v, tid, windowStart, windowEnd);
+        } else {
+            const int tid = tbx_name2id(idx_t, windowChrom.c_str());
+            iter_q = (tid < 0) ? nullptr : tbx_itr_queryi(idx_t, tid, windowStart, windowEnd);
+        }
+        if (iter_q == nullptr) {
+            return fw;
+        }
+        int *distance = variant_distance;
+        int noDistanceFilter = std::numeric_limits<int>::max() / 4;
+        variant_distance = &noDistanceFilter;
+        resetFetched();
+        fetch_start = windowStart;
+        fetch_end = windowEnd;
+        done = false;
+        while (true) {
+            rid.clear();
+            parent.clear();
+            unique_id.clear();
+            vartype.clear();
+            next();
+            if (done) {
+                break;
+            }
+            FeatureRecord r{};
+            r.start = start;
+            r.end = stop;
+            r.strand = strand;
+            r.chrom = st.intern(chrom);
+            r.vartype = st.intern(vartype);
+            r.parent = st.intern(parent);
+            r.line = st.addText(variantString);
+            r.name = st.addText(rid);
+            r.uniqueId = st.addText(unique_id);
+            fw.blocks.add(r.start, r.end, r);
+        }
+        variant_distance = distance;
+        hts_itr_destroy(iter_q);
+        iter_q = nullptr;
+        fw.blocks.index();
+        return fw;
+    }
+
+    void GwTrack::fetchBigWig(const Utils::Region *rgn) {
+        const int qStart = std::max(1, rgn->start - 100000);
+        const int qEnd = rgn->end + 100000;
+        bigWig_intervals = nullptr;
+        bigWig_begin = 0;
+        bigWig_end = 0;
+        done = true;
+        // Zoomed out, a pixel covers many bases. The zoom level summarising at most one pixel is read
+        // instead of per-base values, so a whole chromosome costs a few thousand records
+        const int zoomLevel = (bigWig_basesPerPixel >= 2) ? bwGetZoomLevel(bigWig_fp, (uint32_t)bigWig_basesPerPixel) : -1;
+        auto *w = bigWigCache.find(rgn->chrom, qStart, qEnd, zoomLevel);
+        if (w == nullptr) {
+            const int slack = (qEnd - qStart) / 2;
+            const int wStart = std::max(1, qStart - slack);
+            const int wEnd = qEnd + slack;
+            if (loader) {
+                loader->request(*this, rgn->chrom, wStart, wEnd, zoomLevel);
+                loading = true;
+                return;
+            }
+            std::shared_ptr<bwOverlappingIntervals_t> iv = readBigWigWindow(rgn->chrom, wStart, wEnd, zoomLevel);
+            const size_t bytes = windowBytes(iv.get());
+            w = &bigWigCache.insert(rgn->chrom, wStart, wEnd, bytes, std::move(iv), zoomLevel);
+        }
+        bigWig_intervals = w->value.get();
+        if (bigWig_intervals != nullptr && bigWig_intervals->l > 0) {  // ordered by start
+            const uint32_t *first = bigWig_intervals->start;
+            const uint32_t *last = first + bigWig_intervals->l;
+            bigWig_begin = (uint32_t)(std::lower_bound(first, last, (uint32_t)qStart) - first);
+            bigWig_end = (uint32_t)(std::lower_bound(first, last, (uint32_t)qEnd) - first);
+            // A zoom record starting before the padded region can still cover part of it
+            if (bigWig_intervals->end && bigWig_begin > 0 && (int)bigWig_intervals->end[bigWig_begin - 1] > qStart) {
+                bigWig_begin -= 1;
+            }
+        }
+    }
+
+    std::shared_ptr<bwOverlappingIntervals_t> GwTrack::readBigWigWindow(const std::string &windowChrom, int windowStart, int windowEnd,
+                                                                        int zoomLevel) {
+        bwOverlappingIntervals_t *iv;
+        if (zoomLevel >= 0) {
+            iv = bwGetZoomIntervals(bigWig_fp, windowChrom.c_str(), (uint32_t)windowStart, (uint32_t)windowEnd, zoomLevel);
+        } else {
+            iv = bwGetValues(bigWig_fp, windowChrom.c_str(), (uint32_t)windowStart, (uint32_t)windowEnd, 0);
+        }
+        return std::shared_ptr<bwOverlappingIntervals_t>(iv, [](bwOverlappingIntervals_t *p) { if (p) bwDestroyOverlappingIntervals(p); });
+    }
+
+    bool GwTrack::adoptLoaded() {
+        if (!loader) {
+            return false;
+        }
+        std::vector<TrackLoader::Loaded> loaded = loader->take();
+        if (loaded.empty()) {
+            return false;
+        }
+        // Inserting can evict the window of the last fetch, the next frame fetches again anyway
+        resetFetched();
+        bigWig_intervals = nullptr;
+        bigWig_begin = 0;
+        bigWig_end = 0;
+        for (auto &l : loaded) {
+            if (kind == BIGWIG) {
+                bigWigCache.insert(l.chrom, l.start, l.end, l.bytes, std::move(l.bigWig), l.zoomLevel);
+            } else {
+                fetchCache.insert(l.chrom, l.start, l.end, l.bytes, std::move(l.features));
+            }
+        }
+        return true;
+    }
+
+    TrackLoader::TrackLoader(BS::thread_pool &pool, std::function<void()> notify)
+        : pool(pool), state(std::make_shared<State>()) {
+        state->notify = std::move(notify);
+    }
+
+    TrackLoader::State::~State() {
+        if (reader) {
+            reader->close();
+        }
+    }
+
+    bool TrackLoader::supports(FType kind) {
+        return kind == BED_IDX || kind == PAF_IDX || kind == VCF_IDX || kind == GFF3_IDX || kind == GTF_IDX ||
+               kind == BCF_IDX || kind == BIGWIG || kind == BIGBED;
+    }
+
+    void TrackLoader::request(const GwTrack &owner, const std::string &chrom, int start, int end, int zoomLevel) {
+        std::lock_guard<std::mutex> lock(state->mtx);
+        auto covers = [&](const std::optional<Window> &w) {
+            return w && w->chrom == chrom && w->start <= start && w->end >= end && w->zoomLevel == zoomLevel;
+        };
+        if (covers(state->active) || covers(state->queued)) {
+            return;
+        }
+        if (state->path.empty()) {
+            state->path = owner.path;
+            state->labelRules = owner.track_label_parser_rules;
+        }
+        state->queued = Window{chrom, start, end, zoomLevel};
+        if (!state->running) {
+            state->running = true;
+            std::shared_ptr<State> st = state;
+            pool.push_task([st]() { run(st); });
+        }
+    }
+
+    std::vector<TrackLoader::Loaded> TrackLoader::take() {
+        std::lock_guard<std::mutex> lock(state->mtx);
+        std::vector<Loaded> out;
+        out.swap(state->finished);
+        return out;
+    }
+
+    void TrackLoader::run(const std::shared_ptr<State> &st) {
+        while (true) {
+            Window w;
+            {
+                std::lock_guard<std::mutex> lock(st->mtx);
+                if (!st->queued) {
+                    st->running = false;
+                    st->active.reset();
+                    return;
+                }
+                w = *st->queued;
+                st->queued.reset();
+                st->active = w;
+            }
+            Loaded out{w.chrom, w.start, w.end, w.zoomLevel, 0, {}, nullptr};
+            try {
+                if (st->failed) {
+                    throw std::runtime_error("track could not be opened");
+                }
+                if (!st->reader) {
+                    st->reader = std::make_unique<GwTrack>();
+                    st->reader->track_label_parser_rules = st->labelRules;
+                    st->reader->open(st->path, true);
+                }
+                if (st->reader->kind == BIGWIG) {
+                    out.bigWig = st->reader->readBigWigWindow(w.chrom, w.start, w.end, w.zoomLevel);
+                    out.bytes = windowBytes(out.bigWig.get());
+                } else {
+                    out.features = st->reader->readWindow(w.chrom, w.start, w.end);
+                    out.bytes = windowBytes(out.features);
+                }
+            } catch (const std::exception &) {
+                // An empty window ends the placeholder, open has already reported the error
+                st->failed = true;
+                st->reader.reset();
+                out.features.store = std::make_shared<FeatureStore>();
+            }
+            {
+                std::lock_guard<std::mutex> lock(st->mtx);
+                st->finished.push_back(std::move(out));
+                st->active.reset();
+            }
+            if (st->notify) {
+                st->notify();
+            }
+        }
+    }
+
+    void GwTrack::parseVcfRecord(Utils::TrackBlock &b) {
+        kstring_t kstr = {0,0,0};
+        bcf_unpack(v, BCF_UN_INFO);
+        vcf_format(hdr, v, &kstr);
+        b.line = kstr.s;
+        b.chrom = bcf_hdr_id2name(hdr, v->rid);
+        b.start = (int)v->pos;
+        b.end = b.start + v->rlen;
+        b.name = v->d.id;
+        switch (bcf_get_variant_types(v)) {
+            case VCF_SNP: b.vartype = "SNP"; break;
+            case VCF_INDEL: b.vartype = "INDEL"; break;
+            case VCF_OVERLAP: b.vartype = "OVERLAP"; break;
+            case VCF_BND: b.vartype = "BND"; break;
+            case VCF_OTHER: b.vartype = "OTHER"; break;
+            case VCF_MNP: b.vartype = "MNP"; break;
+            default: b.vartype = "REF";
+        }
+        bcf_info_t * info_field = bcf_get_info(hdr, v, "SVTYPE");  // try and find chrom2 in info
+        if (info_field != nullptr) {
+            char *svtmem = nullptr;
+            int mem = 0;
+            int resc = bcf_get_info_string(hdr, v, "SVTYPE", &svtmem,&mem);
+            if (resc < 0) {
+            } else {
+                b.vartype = svtmem;
+            }
+            free(svtmem);
+        }
+        free(kstr.s);
+    }
+
+    void GwTrack::parseVcfRecord() {
+//        bcf_unpack(v, BCF_UN_INFO);
+        kstring_t kstr = {0,0,0};
+        bcf_unpack(v, BCF_UN_INFO);
+        vcf_format(hdr, v, &kstr);
+        variantString = kstr.s;
+
+        chrom = bcf_hdr_id2name(hdr, v->rid);
+        start = (int)v->pos;
+        stop = (int)start + v->rlen;
+        rid = v->d.id;
+        switch (bcf_get_variant_types(v)) {
+            case VCF_SNP: vartype = "SNP"; break;
+            case VCF_INDEL: vartype = "INDEL"; break;
+            case VCF_OVERLAP: vartype = "OVERLAP"; break;
+            case VCF_BND: vartype = "BND"; break;
+            case VCF_OTHER: vartype = "OTHER"; break;
+            case VCF_MNP: vartype = "MNP"; break;
+            default: vartype = "REF";
+        }
+        bcf_info_t * info_field = bcf_get_info(hdr, v, "SVTYPE");  // try and find chrom2 in info
+        if (info_field != nullptr) {
+            char *svtmem = nullptr;
+            int mem = 0;
+            int resc = bcf_get_info_string(hdr, v, "SVTYPE", &svtmem,&mem);
+            if (resc < 0) {
+            } else {
+                vartype = svtmem;
+            }
+            free(svtmem);
+        }
+        free(kstr.s);
+    }
+
+    void GwTrack::setPaint(SkPaint &faceColour) {
+        this->faceColour = faceColour;
+        this->faceColour.setAntiAlias(true);
+        this->shadedFaceColour.setAntiAlias(true);
+        int c = faceColour.getColor();
+        this->shadedFaceColour.setARGB(faceColour.getAlpha() * 0.5, SkColorGetR(c), SkColorGetG(c), SkColorGetB(c));
+    }
+
+    void GwTrack::open(const std::string &p, bool add_to_dict, BS::thread_pool *pool) {
+        fileIndex = 0;
+        path = p;
+        done = false;
+        this->add_to_dict = add_to_dict;
         std::string path_lower = p;
         std::transform(path_lower.begin(), path_lower.end(), path_lower.begin(),
                        [](unsigned char c) { return (char)std::tolower(c); });
@@ -1806,9 +2552,28 @@ namespace HGW {
             kind = BIGBED;
         } else if (Utils::endsWith(path_lower, ".paf")) {
             kind = PAF_NOI;
+        } else if (Utils::endsWith(path_lower, ".paf.gz")) {
+            kind = PAF_IDX;
         } else {
             kind = GW_LABEL;
         }
+        mappedBlocks.reset();
+        sharedBlocks.reset();
+        indexedCopy.clear();
+        nameIndex.reset();
+        resetFetched();
+        fetchCache.clear();
+        bigWigCache.clear();
+        loader.reset();
+        loading = false;
+        store = std::make_shared<FeatureStore>();
+        if (add_to_dict && (kind == BED_NOI || kind == GW_LABEL || kind == PAF_NOI || kind == GFF3_NOI || kind == GTF_NOI)
+            && openCachedBlocks()) {
+            return;
+        }
+        if (add_to_dict && kind == VCF_NOI && openIndexedVcfCopy()) {
+            return;
+        }
         // if drawing image tiles, VCF/BCF files are opened with VCFfile class
         // only tracks are processed here:
         if (kind == VCF_NOI) {
@@ -1824,22 +2589,45 @@ namespace HGW {
             }
             v = bcf_init1();
             v->max_unpack = BCF_UN_INFO;
+            // Lines are read here rather than by bcf_read, so that a large file is also copied to an
+            // indexed file on the way, and later sessions read it by region
+            std::unique_ptr<VcfCopyWriter> copy;
+            const std::string copyPath = (add_to_dict) ? indexedVcfCopyPath(path) : std::string();
+            if (!copyPath.empty()) {
+                copy = std::make_unique<VcfCopyWriter>(path, copyPath, hdr);
+            }
+            kstring_t line = {0, 0, nullptr};
             while (true) {
-                int res = bcf_read(fp, hdr, v);
-                if (res < -1) {
-                    std::cerr << "Error: reading vcf resulted in error code " << res << std::endl;
-                    throw std::runtime_error("bcf_read error");
-                } else if (res == -1) {
+                int res = hts_getline(fp, '\n', &line);
+                if (res == -1) {
                     done = true;
                     break;
                 }
+                if (res >= 0) {
+                    if (copy) {
+                        copy->add(line);
+                    }
+                    res = vcf_parse(&line, hdr, v);
+                }
+                if (res < 0) {
+                    free(line.s);
+                    std::cerr << "Error: reading vcf resulted in error code " << res << std::endl;
+                    throw std::runtime_error("bcf_read error");
+                }
+                if (copy) {
+                    copy->checkSorted(v->rid, v->pos);
+                }
                 Utils::TrackBlock b;
                 parseVcfRecord(b);
-                allBlocks[b.chrom].add(b.start, b.end, b);
+                addBlock(b);
             }
+            free(line.s);
             for (auto &item : allBlocks) {
                 item.second.index();
             }
+            if (copy) {
+                copy->finish();
+            }
         } else if (kind == BED_NOI || kind == GW_LABEL) {
 
 #if !defined(__EMSCRIPTEN__)
@@ -1870,51 +2658,7 @@ namespace HGW {
             if (!add_to_dict) {
                 return;
             }
-            while (true) {
-                auto got_line = (bool)getline(*fpu, tp);
-                if (!got_line) {
-                    done = true;
-                    break;
-                }
-                if (tp.empty() || tp[0] == '#') {
-                    continue;
-                }
-                std::vector<std::string> parts = Utils::split(tp, '\t');
-                if (parts.size() < 2) {
-                    std::cerr << "Warning: skipping malformed line in " << path << ": " << tp << std::endl;
-                    continue;
-                }
-                Utils::TrackBlock b;
-                b.line = tp;
-                b.chrom = parts[0];
-                b.start = std::stoi(parts[1]);
-                if (kind == BED_NOI) {  // bed
-                    if (parts.size() < 3) {
-                        std::cerr << "Warning: skipping malformed BED line in " << path << ": " << tp << std::endl;
-                        continue;
-                    }
-                    b.end = std::stoi(parts[2]);
-                    if (parts.size() > 3) {
-                        b.name = parts[3];
-                        if (parts.size() >= 6) {
-                            if (parts[5] == "+") {
-                                b.strand = 1;
-                            } else if (parts[5] == "-") {
-                                b.strand = 2;
-                            }
-                        }
-                    } else {
-                        b.name = std::to_string(fileIndex);
-                        fileIndex += 1;
-                    }
-                } else { // assume gw_label file
-                    b.end = b.start + 1;
-                }
-                allBlocks[b.chrom].add(b.start, b.end, b);
-            }
-            for (auto &item : allBlocks) {
-                item.second.index();
-            }
+            loadBlocks(pool);
         } else if (kind == PAF_NOI) {
 #if !defined(__EMSCRIPTEN__)
             if (Utils::startsWith(path, "http") || Utils::startsWith(path, "ftp")) {
@@ -1942,32 +2686,7 @@ namespace HGW {
             if (!add_to_dict) {
                 return;
             }
-            while (true) {
-                auto got_line = (bool)getline(*fpu, tp);
-                if (!got_line) {
-                    done = true;
-                    break;
-                }
-                if (tp.empty() || tp[0] == '#') {
-                    continue;
-                }
-                std::vector<std::string> parts = Utils::split(tp, '\t');
-                if (parts.size() < 9) {
-                    std::cerr << "Warning: skipping malformed PAF line in " << path << ": " << tp << std::endl;
-                    continue;
-                }
-                Utils::TrackBlock b;
-                b.line = tp;
-                b.name = parts[0];
-                b.chrom = parts[5];
-                b.start = std::stoi(parts[7]);
-                b.strand = (parts[4] == "+") ? 1 : 2;
-                b.end = std::stoi(parts[8]);
-                allBlocks[b.chrom].add(b.start, b.end, b);
-            }
-            for (auto &item : allBlocks) {
-                item.second.index();
-            }
+            loadBlocks(pool);
         } else if (kind == GFF3_IDX || kind == GTF_IDX) {
             fp = hts_open(p.c_str(), "r");
             if (!fp) {
@@ -2008,99 +2727,10 @@ namespace HGW {
             if (!add_to_dict) {
                 return;
             }
-            // Resolve label-rule key once outside the loop.
-            const std::string chosenLabelKey = getTrackLabelRuleForFormat(
-                track_label_parser_rules,
-                (kind == GTF_NOI) ? AnnotationLabelFormat::GTF
-                                  : AnnotationLabelFormat::GFF3);
-            constexpr int MAX_COLS = 9;
-            size_t colStart[MAX_COLS], colEnd[MAX_COLS];
-            int count = 0;
-            ankerl::unordered_dense::map< std::string, std::vector<Utils::TrackBlock>> track_blocks;
-            while (true) {
-                auto got_line = (bool)getline(*fpu, tp);
-                if (!got_line) {
-                    done = true;
-                    break;
-                }
-                count += 1;
-                if (tp.empty() || tp[0] == '#') {
-                    continue;
-                }
-
-                int nCols = splitTabsInPlace(tp, colStart, colEnd, MAX_COLS);
-                if (nCols < 9) {
-                    std::cerr << "Error: parsing file, not enough columns in line split by tab. n columns = "
-                              << nCols << ", line was: " << tp << ", at file index " << count << std::endl;
-                    continue;
-                }
-
-                // GTF_NOI: only "exon" rows are kept. Check before any allocation.
-                if (kind == GTF_NOI) {
-                    size_t ts = colStart[2], te = colEnd[2];
-                    if (te - ts != 4 || std::memcmp(tp.data() + ts, "exon", 4) != 0) {
-                        continue;
-                    }
-                }
-
-                Utils::TrackBlock b;
-                b.line = tp;
-                // Populate b.parts from the precomputed offsets — cheaper than a
-                // second Utils::split, but keeps b.parts available for downstream
-                // consumers (e.g. collectGFFTrackData reading parts[6]).
-                b.parts.resize(nCols);
-                for (int ci = 0; ci < nCols; ++ci) {
-                    b.parts[ci].assign(tp, colStart[ci], colEnd[ci] - colStart[ci]);
-                }
-                b.chrom.assign(tp, colStart[0], colEnd[0] - colStart[0]);
-                b.vartype.assign(tp, colStart[2], colEnd[2] - colStart[2]);
-                // strtol on raw buffer beats std::stoi(temporary string).
-                b.start = (int)std::strtol(tp.c_str() + colStart[3], nullptr, 10) - 1;
-                b.end   = (int)std::strtol(tp.c_str() + colStart[4], nullptr, 10);
-
-                char strandCh = (colEnd[6] > colStart[6]) ? tp[colStart[6]] : '.';
-                b.strand = (strandCh == '+') ? 1 : (strandCh == '-' ? 2 : 0);
-
-                std::string attrs_raw(tp, colStart[8], colEnd[8] - colStart[8]);
-                if (kind == GFF3_NOI) {
-                    std::string id, name, parent, geneName;
-                    extractGff3Attrs(attrs_raw, &id, &name, &parent, &geneName);
-                    if (!parent.empty()) b.parent = std::move(parent);
-                    if (!id.empty())     b.unique_id = std::move(id);
-                    if (chosenLabelKey != "auto") {
-                        b.name = resolveGff3LabelFast(attrs_raw, chosenLabelKey);
-                    } else {
-                        if (!geneName.empty())          b.name = std::move(geneName);
-                        else if (!name.empty())         b.name = std::move(name);
-                        else if (!b.unique_id.empty())  b.name = b.unique_id;
-                    }
-                } else {  // GTF_NOI
-                    std::string geneId, geneName, transcriptId;
-                    extractGtfAttrs(attrs_raw, &geneId, &geneName, &transcriptId);
-                    // Preserve old last-wins precedence: gene_id, then gene_name
-                    // overwrites, then transcript_id overwrites.
-                    if (!geneId.empty())       b.parent = geneId;
-                    if (!geneName.empty())     b.parent = geneName;
-                    if (!transcriptId.empty()) b.parent = transcriptId;
-                    if (chosenLabelKey != "auto") {
-                        b.name = resolveGtfLabelFast(attrs_raw, chosenLabelKey);
-                    } else {
-                        if (!geneName.empty())          b.name = std::move(geneName);
-                        else if (!geneId.empty())       b.name = std::move(geneId);
-                        else if (!transcriptId.empty()) b.name = std::move(transcriptId);
-                    }
-                }
-                if (b.name.empty()) {
-                    continue;
-                }
-                allBlocks[b.chrom].add(b.start, b.end, b);
-            }
-            for (auto &item : allBlocks) {
-                item.second.index();
-            }
+            loadBlocks(pool);
             return;
 
-        } else if (kind == BED_IDX) {
+        } else if (kind == BED_IDX || kind == PAF_IDX) {
             fp = hts_open(p.c_str(), "r");
             if (!fp) {
                 std::cerr << "Error: could not open " << path << std::endl;
@@ -2111,6 +2741,7 @@ namespace HGW {
                 std::cerr << "Error: could not open index of " << path << std::endl;
                 throw std::exception();
             }
+            pafByQuery = kind == PAF_IDX && idx_t->conf.sc == 1;
         } else if (kind == BCF_IDX) {
             fp = bcf_open(p.c_str(), "r");
             if (!fp) {
@@ -2166,77 +2797,68 @@ namespace HGW {
     }
 
     void GwTrack::fetch(const Utils::Region *rgn) {
-        if (kind > BCF_IDX) {  // non-indexed
+        if (isNonIndexed(kind)) {
             if (rgn == nullptr) {
 
             } else {
-                if (allBlocks.contains(rgn->chrom)) {
+                loadCachedChrom(rgn->chrom);
+                const auto &blocks = (sharedBlocks) ? sharedBlocks->blocks : allBlocks;
+                auto found = blocks.find(rgn->chrom);
+                if (found != blocks.end()) {
+                    // Only positions are collected, so a dense track at wide zoom reuses the same buffer
                     overlappingBlocks.clear();
-
-                    allBlocks[rgn->chrom].findOverlaps(rgn->start - 200000, rgn->end + 200000, overlappingBlocks);
+                    fetchedBlocks = &found->second;
+                    found->second.findIndexes(rgn->start - 200000, rgn->end + 200000, overlappingBlocks);
 
                     if (overlappingBlocks.empty()) {
                         done = true;
                         return;
                     }
                     done = false;
-                    // Superintervals return items in reverse order
-                    std::reverse(overlappingBlocks.begin(), overlappingBlocks.end());
                     fetch_start = rgn->start;
                     fetch_end = rgn->end;
-                    iter_blk = overlappingBlocks.begin();
-                    vals_end = overlappingBlocks.end();
+                    iter_blk = overlappingBlocks.crbegin();
+                    vals_end = overlappingBlocks.crend();
                 } else {
                     done = true;
                 }
             }
         } else {
-            if (kind == BED_IDX || kind == VCF_IDX || kind == GFF3_IDX || kind == GTF_IDX) {
-                if (rgn == nullptr) {
+            loading = false;
+            if (kind == BED_IDX || kind == PAF_IDX || kind == VCF_IDX || kind == GFF3_IDX || kind == GTF_IDX || kind == BCF_IDX) {
+                if (rgn == nullptr) {  // iterate the whole file
+                    resetFetched();
                     iter_q = nullptr;
                     done = false;
                 } else {
-                    int tid = tbx_name2id(idx_t, rgn->chrom.c_str());
-                    if (kind == GFF3_IDX || kind == GTF_IDX) {
-                        iter_q = tbx_itr_queryi(idx_t, tid, std::max(1, rgn->start - 100000), rgn->end + 100000);
-                    } else {
-                        iter_q = tbx_itr_queryi(idx_t, tid, rgn->start, rgn->end);
-                    }
-                    if (iter_q == nullptr) {
-                        done = true;
-                    } else {
-                        done = false;
-                        fetch_start = rgn->start;
-                        fetch_end = rgn->end;
-                    }
-                }
-            } else if (kind == BCF_IDX) {
-                int tid = bcf_hdr_name2id(hdr, rgn->chrom.c_str());
-                iter_q = bcf_itr_queryi(idx_v, tid, rgn->start, rgn->end);
-                if (iter_q == nullptr) {
-                    done = true;
-                } else {
-                    done = false;
-                    fetch_start = rgn->start;
-                    fetch_end = rgn->end;
+                    fetchWindow(rgn);
                 }
             } else if (kind == BIGWIG) {
-                bigWig_intervals = bwGetValues(bigWig_fp, rgn->chrom.c_str(), (uint32_t)std::max(1, rgn->start - 100000), (uint32_t)rgn->end + 100000, 0);
-                done = true;
-
+                fetchBigWig(rgn);
             } else if (kind == BIGBED) {
-                bigBed_entries = bbGetOverlappingEntries(bigWig_fp, rgn->chrom.c_str(), (uint32_t)std::max(1, rgn->start), (uint32_t)rgn->end, 1);
-                chrom = rgn->chrom;
-                current_iter_index = 0;
-                done = false;
-                num_intervals = (int)bigBed_entries->l;
-                if (current_iter_index == num_intervals) {
-                    done = true;
-                }
+                fetchWindow(rgn);
             }
         }
     }
 
+    const FeatureRecord *GwTrack::nextRecord() {
+        if (done || fetchedBlocks == nullptr) {
+            done = true;
+            return nullptr;
+        }
+        const bool isVcf = kind == VCF_NOI || kind == VCF_IDX || kind == BCF_IDX;
+        while (iter_blk != vals_end) {
+            const FeatureRecord &r = fetchedBlocks->data[*iter_blk];
+            ++iter_blk;
+            if (isVcf && (r.start < fetch_start - *variant_distance && r.end > fetch_end + *variant_distance)) {
+                continue;
+            }
+            return &r;
+        }
+        done = true;
+        return nullptr;
+    }
+
     void GwTrack::next() {
         int res;
         if (done) {
@@ -2244,9 +2866,10 @@ namespace HGW {
         }
         strand = 0;
 
-        if (kind > BCF_IDX) {  // non indexed cached VCF_NOI / BED_NOI / GFF3 (todo) / GW_LABEL / STDIN?
+        // non indexed cached VCF_NOI / BED_NOI / GFF3 / GW_LABEL / STDIN?, or an indexed track served from fetchCache
+        if (isNonIndexed(kind) || fetchedBlocks != nullptr) {
             // add_to_dict==false, only BED and GW_LABEL files supported (iterate whole file)
-            if (!add_to_dict) {
+            if (!add_to_dict && isNonIndexed(kind)) {
                 // nullptr is an indication to iterate over everything
                 while (true) {
                     auto got_line = (bool)getline(*fpu, tp);
@@ -2257,22 +2880,25 @@ namespace HGW {
                     if (tp.empty() || tp[0] == '#') {
                         continue;
                     }
-                    std::vector<std::string> parts = Utils::split_keep_empty_str(tp, '\t');
-                    if (parts.size() < 3) {
+                    std::string_view cols[6];
+                    const int nCols = Utils::splitView(tp, '\t', cols, 6, true);
+                    if (nCols < 3 || !Utils::parseInt(cols[1], start)) {
                         std::cerr << "Warning: skipping malformed line in " << path << ": " << tp << std::endl;
                         continue;
                     }
-                    chrom = parts[0];
+                    chrom = cols[0];
                     chrom2 = chrom;
-                    start = std::stoi(parts[1]);
                     if (kind == BED_NOI) {  // bed
-                        stop = std::stoi(parts[2]);
-                        if (parts.size() > 3) {
-                            rid = parts[3];
-                            if (parts.size() >= 6) {
-                                if (parts[5] == "+") {
+                        if (!Utils::parseInt(cols[2], stop)) {
+                            std::cerr << "Warning: skipping malformed BED line in " << path << ": " << tp << std::endl;
+                            continue;
+                        }
+                        if (nCols > 3) {
+                            rid = cols[3];
+                            if (nCols >= 6) {
+                                if (cols[5] == "+") {
                                     strand = 1;
-                                } else if (parts[5] == "-") {
+                                } else if (cols[5] == "-") {
                                     strand = 2;
                                 }
                             }
@@ -2285,7 +2911,7 @@ namespace HGW {
                         }
 
                         stop = start + 1;
-                        rid = parts[2];
+                        rid = cols[2];
                     }
                     fileIndex += 1;
                     break;
@@ -2294,28 +2920,20 @@ namespace HGW {
             }
             // Values fetched from interval tree
             else {
-                while (true) {
-                    if (iter_blk != vals_end) {
-                        chrom = iter_blk->chrom;
-                        chrom2 = chrom;
-                        start = iter_blk->start;
-                        stop = iter_blk->end;
-                        rid = iter_blk->name;
-                        parent = iter_blk->parent;
-                        unique_id = iter_blk->unique_id;
-                        vartype = iter_blk->vartype;
-                        strand = iter_blk->strand;
-                        variantString = iter_blk->line;
-                        parts = iter_blk->parts;
-                        ++iter_blk;
-                        if (kind == VCF_NOI && (start < fetch_start - *variant_distance && stop > fetch_end + *variant_distance)) {
-                            continue;
-                        }
-                        break;
-                    } else {
-                        done = true;
-                        break;
-                    }
+                const FeatureRecord *r = nextRecord();
+                if (r != nullptr) {
+                    const FeatureStore &st = *store;
+                    chrom = st.str(r->chrom);
+                    chrom2 = chrom;
+                    start = r->start;
+                    stop = r->end;
+                    rid = st.text(r->name);
+                    parent = st.str(r->parent);
+                    unique_id = st.text(r->uniqueId);
+                    vartype = st.str(r->vartype);
+                    strand = r->strand;
+                    variantString = st.text(r->line);
+                    parts.clear();  // split from variantString by consumers that need columns
                 }
                 return;
             }
@@ -2343,7 +2961,7 @@ namespace HGW {
                 done = true;
                 return;
             }
-            kstring_t str = {0,0, nullptr};
+            static thread_local kstring_t str = {0, 0, nullptr};  // line buffer reused across calls
             while (true) {
                 res = tbx_itr_next(fp, idx_t, iter_q, &str);
                 if (res < 0) {
@@ -2368,8 +2986,8 @@ namespace HGW {
                 break;
             }
 
-        } else if (kind == BED_IDX || kind == GFF3_IDX || kind == GTF_IDX) {
-            kstring_t str = {0,0, nullptr};
+        } else if (kind == BED_IDX || kind == PAF_IDX || kind == GFF3_IDX || kind == GTF_IDX) {
+            static thread_local kstring_t str = {0, 0, nullptr};  // line buffer reused across calls
             while (true) {
                 if (iter_q != nullptr) {
                     res = tbx_itr_next(fp, idx_t, iter_q, &str);
@@ -2390,17 +3008,32 @@ namespace HGW {
                         return;
                     }
                 }
-                if (kind == BED_IDX) {
+                const std::string_view line(str.s, str.l);
+                if (kind == PAF_IDX) {
+                    // Like PAF_NOI records, columns are left unsplit
+                    std::string_view pafChrom, pafName;
+                    if (!parsePafLine(line, pafByQuery, pafChrom, start, stop, pafName, strand)) {
+                        std::cerr << "Warning: skipping malformed PAF line in " << path << ": " << line << std::endl;
+                        continue;
+                    }
+                    chrom = pafChrom;
+                    chrom2 = chrom;
+                    rid = pafName;
+                    variantString = line;
+                    vartype.clear();
                     parts.clear();
-                    parts = Utils::split(str.s, '\t');
-                    if (parts.size() < 3) {
-                        std::cerr << "Warning: skipping malformed BED line in " << path << ": " << str.s << std::endl;
+                    break;
+                }
+                // parts is read by collectTrackData, so fill it in place
+                Utils::splitInto(line, '\t', parts, true);
+                if (kind == BED_IDX) {
+                    if (parts.size() < 3 || !Utils::parseInt(parts[1], start) || !Utils::parseInt(parts[2], stop)) {
+                        std::cerr << "Warning: skipping malformed BED line in " << path << ": " << line << std::endl;
                         continue;
                     }
                     chrom = parts[0];
                     chrom2 = chrom;
-                    start = std::stoi(parts[1]);
-                    stop = std::stoi(parts[2]);
+                    variantString = line;
                     if (parts.size() > 3) {
                         rid = parts[3];
                         if (parts.size() >= 6) {
@@ -2414,157 +3047,169 @@ namespace HGW {
                         rid = std::to_string(fileIndex);
                         fileIndex += 1;
                     }
-                    vartype = "";
+                    vartype.clear();
                     break;
                 }
 
-                parts.clear();
-                parts = Utils::split(str.s, '\t');
-                if (parts.size() < 9) {
-                    std::cerr << "Warning: skipping malformed GFF/GTF line in " << path << ": " << str.s << std::endl;
+                if (parts.size() < 9 || !Utils::parseInt(parts[3], start) || !Utils::parseInt(parts[4], stop)) {
+                    std::cerr << "Warning: skipping malformed GFF/GTF line in " << path << ": " << line << std::endl;
                     continue;
                 }
+                if (kind == GTF_IDX && parts[2] != "exon") {
+                    continue;
+                }
+                start -= 1;
                 chrom = parts[0];
                 chrom2 = chrom;
-                start = std::stoi(parts[3]) - 1;
-                stop = std::stoi(parts[4]);
-                if (parts[6] == "+") {
-                    strand = 1;
-                } else {
-                    strand = 2;
-                }
+                strand = (parts[6] == "+") ? 1 : ((parts[6] == "-") ? 2 : 0);
                 vartype = parts[2];
-                rid.clear();
-                parent.clear();
-                unique_id.clear();
-                if (kind == GTF_IDX && vartype != "exon") {
-                    continue;
-                }
-                if (kind == GFF3_IDX) {
-                    const auto attrs = parseGffAttributes(parts[8]);
-                    rid = resolveTrackLabel(attrs, AnnotationLabelFormat::GFF3, track_label_parser_rules);
-                    auto parent_it = attrs.find("Parent");
-                    if (parent_it != attrs.end()) {
-                        parent = parent_it->second;
-                    }
-                    auto id_it = attrs.find("ID");
-                    if (id_it != attrs.end()) {
-                        unique_id = id_it->second;
-                    }
-                } else {  // GTF_IDX
-                    const auto attrs = parseGtfAttributes(parts[8]);
-                    auto gene_id_it = attrs.find("gene_id");
-                    if (gene_id_it != attrs.end()) {
-                        parent = gene_id_it->second;
-                    }
-                    auto gene_name_it = attrs.find("gene_name");
-                    if (gene_name_it != attrs.end()) {
-                        parent = gene_name_it->second;
-                    }
-                    auto transcript_id_it = attrs.find("transcript_id");
-                    if (transcript_id_it != attrs.end()) {
-                        parent = transcript_id_it->second;
-                    }
-                    rid = resolveTrackLabel(attrs, AnnotationLabelFormat::GTF, track_label_parser_rules);
-                }
+                variantString = line;
+                const bool gtf = kind == GTF_IDX;
+                const AnnotationAttrs attrs = resolveAnnotationAttrs(parts[8], gtf, getTrackLabelRuleForFormat(
+                        track_label_parser_rules, (gtf) ? AnnotationLabelFormat::GTF : AnnotationLabelFormat::GFF3));
+                rid = attrs.name;
+                parent = attrs.parent;
+                unique_id = (gtf) ? std::string_view() : attrs.uniqueId;
                 break;
             }
-        } else if (kind == BIGBED) {
-            if (current_iter_index == num_intervals) {
-                done = true;
-                return;
-            }
-            start = (int)bigBed_entries->start[current_iter_index];
-            stop = (int)bigBed_entries->end[current_iter_index];
-            if (bigBed_entries->str != nullptr) {
-                parts = Utils::split(bigBed_entries->str[current_iter_index], '\t');
-                rid = parts[0];
-            }
-            current_iter_index += 1;
-            chrom2 = chrom;
         }
     }
 
-    bool GwTrack::findFeature(std::string &feature, Utils::Region &region) {
-        if (kind == BED_IDX) {
+    std::shared_ptr<const FeatureNameIndex> GwTrack::readNameIndex(const std::string &path, FType kind, const std::string &labelRules,
+                                                                   const std::shared_ptr<MappedTrackFile> &mapped) {
+        const bool indexed = kind == BED_IDX || kind == PAF_IDX || kind == GFF3_IDX || kind == GTF_IDX || kind == VCF_IDX ||
+                             kind == BCF_IDX;
+        if (!indexed && !(mapped && isNonIndexed(kind))) {
+            return nullptr;
+        }
+        if (indexed) {
+            auto saved = FeatureNameIndex::load(path, (int)kind, labelRules);
+            if (saved) {
+                return saved;
+            }
+        }
+        auto idx = std::make_shared<FeatureNameIndex>();
+        if (kind == BED_IDX || kind == PAF_IDX || kind == GFF3_IDX || kind == GTF_IDX) {
             htsFile *fp_temp = hts_open(path.c_str(), "r");
             if (!fp_temp) {
                 std::cerr << "Error: could not open " << path << std::endl;
-                return false;
+                idx->finish();
+                return idx;
+            }
+            const bool gtf = kind == GTF_IDX;
+            const std::string labelKey = (kind == BED_IDX) ? std::string()
+                : getTrackLabelRuleForFormat(labelRules, (gtf) ? AnnotationLabelFormat::GTF : AnnotationLabelFormat::GFF3);
+            bool byQuery = false;
+            if (kind == PAF_IDX) {
+                tbx_t *pafIdx = tbx_index_load(path.c_str());
+                byQuery = pafIdx != nullptr && pafIdx->conf.sc == 1;
+                if (pafIdx) {
+                    tbx_destroy(pafIdx);
+                }
             }
             kstring_t str = {0,0, nullptr};
             int fileIndex_tmp = 0;
-            bool found = false;
+            int s0, e0;
             while (hts_getline(fp_temp, '\n', &str) >= 0) {
-                parts.clear();
-                parts = Utils::split(str.s, '\t');
-                if (parts.size() < 3) {
+                if (str.l == 0 || str.s[0] == '#') {
                     continue;
                 }
-                if (parts.size() > 3) {
-                    rid = parts[3];
+                if (kind == PAF_IDX) {
+                    std::string_view chromView, name;
+                    int pafStrand;
+                    if (parsePafLine(std::string_view(str.s, str.l), byQuery, chromView, s0, e0, name, pafStrand)) {
+                        idx->add(name, chromView, s0, e0);
+                    }
+                } else if (kind == BED_IDX) {
+                    std::string_view cols[4];
+                    const int nCols = Utils::splitView(std::string_view(str.s, str.l), '\t', cols, 4, true);
+                    if (nCols < 3) {
+                        continue;
+                    }
+                    const std::string unnamed = (nCols > 3) ? std::string() : std::to_string(fileIndex_tmp++);
+                    if (Utils::parseInt(cols[1], s0) && Utils::parseInt(cols[2], e0)) {
+                        idx->add((nCols > 3) ? cols[3] : std::string_view(unnamed), cols[0], s0, e0);
+                    }
                 } else {
-                    rid = std::to_string(fileIndex_tmp);
-                    fileIndex_tmp += 1;
-                }
-                if (rid == feature) {
-                    region.chrom = parts[0];
-                    region.start = std::stoi(parts[1]);
-                    region.end = std::stoi(parts[2]);
-                    region.markers = {{region.start, region.end}};
-                    return true;
+                    std::string_view cols[9];
+                    if (Utils::splitView(std::string_view(str.s, str.l), '\t', cols, 9, false) < 9 ||
+                        !Utils::parseInt(cols[3], s0) || !Utils::parseInt(cols[4], e0)) {
+                        continue;
+                    }
+                    const AnnotationAttrs attrs = resolveAnnotationAttrs(cols[8], gtf, labelKey);
+                    idx->add(attrs.name, cols[0], s0 - 1, e0);
+                    idx->add(attrs.uniqueId, cols[0], s0 - 1, e0);
+                    if (gtf) {  // transcript_id
+                        idx->add(attrs.parent, cols[0], s0 - 1, e0);
+                    }
                 }
             }
             if (str.s) free(str.s);
             hts_close(fp_temp);
-            return found;
         } else if (kind == BCF_IDX || kind == VCF_IDX) {
             htsFile *fp2 = bcf_open(path.c_str(), "r");
-            if (!fp2) {
-                std::cerr << "Error: could not open " << path << std::endl;
-                return false;
-            }
-            bcf_hdr_t *hdr2 = bcf_hdr_read(fp2);
+            bcf_hdr_t *hdr2 = (fp2) ? bcf_hdr_read(fp2) : nullptr;
             if (!hdr2) {
-                std::cerr << "Error: could not open header of " << path << std::endl;
-                bcf_close(fp2);
-                return false;
+                std::cerr << "Error: could not open " << path << std::endl;
+                if (fp2) bcf_close(fp2);
+                idx->finish();
+                return idx;
             }
             bcf1_t *v2 = bcf_init1();
-            v2->max_unpack = BCF_UN_INFO;
-            bool found = false;
             while (bcf_read(fp2, hdr2, v2) >= 0) {
-                std::string id_temp;
-                bcf_unpack(v2, BCF_UN_INFO);
-                id_temp = v2->d.id;
-                if (id_temp == feature) {
-                    region.chrom = bcf_hdr_id2name(hdr2, v2->rid);
-                    region.start = (int)v2->pos;
-                    region.end = region.start + v2->rlen;
-                    region.markers = {{region.start, region.end}};
-                    return true;
+                bcf_unpack(v2, BCF_UN_STR);
+                const std::string_view chromName = bcf_hdr_id2name(hdr2, v2->rid);
+                std::string_view ids(v2->d.id);
+                while (!ids.empty()) {  // a record can carry several ids separated by ;
+                    const size_t semi = ids.find(';');
+                    idx->add(ids.substr(0, semi), chromName, (int)v2->pos, (int)(v2->pos + v2->rlen));
+                    ids = (semi == std::string_view::npos) ? std::string_view() : ids.substr(semi + 1);
                 }
             }
             bcf_destroy1(v2);
             bcf_hdr_destroy(hdr2);
             bcf_close(fp2);
-            return found;
-        } else if (kind > BCF_IDX) {
-
-            for (auto &chrom_blocks : allBlocks) {
-                for (int i = (int)chrom_blocks.second.data.size() - 1; i >= 0; --i) {
-                    auto& b = chrom_blocks.second.data[i];
-                    if (b.name.find(feature) != std::string::npos) {
-                        region.chrom = b.chrom;
-                        region.start = b.start;
-                        region.end = b.end;
-                        region.markers = {{b.start, b.end}};
-                        return true;
+        } else {
+            mapped->addNames(*idx, kind == GTF_NOI);
+        }
+        idx->finish();
+        if (indexed) {
+            idx->save(path, (int)kind, labelRules);
+        }
+        return idx;
+    }
+
+    void GwTrack::buildNameIndex() {
+        nameIndex = readNameIndex(path, kind, track_label_parser_rules, mappedBlocks);
+        if (nameIndex) {
+            return;
+        }
+        auto idx = std::make_shared<FeatureNameIndex>();
+        if (store) {
+            const bool withParents = kind == GTF_NOI;
+            for (auto &chrom_blocks : (sharedBlocks) ? sharedBlocks->blocks : allBlocks) {
+                for (const auto &b : chrom_blocks.second.data) {
+                    idx->add(store->text(b.name), chrom_blocks.first, b.start, b.end);
+                    idx->add(store->text(b.uniqueId), chrom_blocks.first, b.start, b.end);
+                    if (withParents) {
+                        idx->add(store->str(b.parent), chrom_blocks.first, b.start, b.end);
                     }
                 }
             }
         }
-        return false;
+        idx->finish();
+        nameIndex = idx;
+    }
+
+    bool GwTrack::findFeature(std::string &feature, Utils::Region &region, bool partial) {
+        if (!nameIndex) {
+            buildNameIndex();
+        }
+        if (nameIndex->find(feature, region)) {
+            return true;
+        }
+        // Non-indexed tracks also match names that contain the search term
+        return partial && isNonIndexed(kind) && nameIndex->findContaining(feature, region);
     }
 
     void GwTrack::printTargetRecord(std::string &id_str, std::string &chrm, int pos) {
@@ -2573,23 +3218,29 @@ namespace HGW {
         } else if (kind == VCF_NOI) {
             return print_VCF_NOI(path, id_str, variantString);
         } else if (kind == VCF_IDX) {
-            return print_VCF_IDX(path, id_str, chrm, pos, variantString);
-        } else if (kind == BED_IDX) {
+            std::string &vcfPath = (indexedCopy.empty()) ? path : indexedCopy;
+            return print_VCF_IDX(vcfPath, id_str, chrm, pos, variantString);
+        } else if (kind == BED_IDX || kind == PAF_IDX) {
             return print_BED_IDX(path, chrm, pos, variantString);
         } else {
-			if (allBlocks.contains(chrm)) {
-				return print_cached(overlappingBlocks, chrm, pos, false, variantString);
+			const auto &blocks = (sharedBlocks) ? sharedBlocks->blocks : allBlocks;
+			auto found = blocks.find(chrm);
+			if (found != blocks.end()) {
+				return print_cached(found->second.data, *store, pos, variantString);
 			} else {
 			}
 		}
     }
 
     bool searchTracks(std::vector<GwTrack> &tracks, std::string &feature, Utils::Region &region) {
-        for (auto &track : tracks) {
-            if (track.findFeature(feature, region)) {
-                region.start = std::max(0, region.start - 100);
-                region.end = region.end + 100;
-                return true;
+        // An exact name in any track is preferred over a partial match in an earlier one
+        for (bool partial : {false, true}) {
+            for (auto &track : tracks) {
+                if (track.findFeature(feature, region, partial)) {
+                    region.start = std::max(0, region.start - 100);
+                    region.end = region.end + 100;
+                    return true;
+                }
             }
         }
         return false;
@@ -2767,6 +3418,14 @@ namespace HGW {
             vcf.label_to_parse = m_opts->parse_label.c_str();
             vcf.open(path);
             trackDone = &vcf.done;
+            if (!cacheStdin) {
+                recordOffsets = std::make_shared<RecordOffsets>();
+                RecordOffsets *state = recordOffsets.get();  // outlives the task, see ~RecordOffsets
+                state->scan = std::async(std::launch::async, [state, p = path]() {
+                    state->offsets = scanRecordOffsets(p, state->cancel);
+                    state->ready.store(true, std::memory_order_release);
+                });
+            }
             if (endIndex > 0) {
                 nextN(endIndex);
             }
@@ -2799,6 +3458,13 @@ namespace HGW {
 
     }
 
+    GwVariantTrack::RecordOffsets::~RecordOffsets() {
+        cancel.store(true, std::memory_order_relaxed);
+        if (scan.valid()) {
+            scan.wait();
+        }
+    }
+
     void GwVariantTrack::nextN(int number) {
         if (number == 0 || type == IMAGES) {
             return;
@@ -2815,25 +3481,58 @@ namespace HGW {
                     if (*trackDone) {
                         break;
                     }
-                    this->appendVariantSite(vcf.chrom, vcf.start, vcf.chrom2, vcf.stop, vcf.rid, vcf.label, vcf.vartype);
+                    this->setVariantSite(nextIndex++, vcf.chrom, vcf.start, vcf.chrom2, vcf.stop, vcf.rid, vcf.label, vcf.vartype);
                 } else {
                     variantTrack.next();
                     if (*trackDone) {
                         break;
                     }
                     std::string label;
-                    this->appendVariantSite(variantTrack.chrom, variantTrack.start, variantTrack.chrom2,
-                                      variantTrack.stop, variantTrack.rid, label, variantTrack.vartype);
+                    this->setVariantSite(nextIndex++, variantTrack.chrom, variantTrack.start, variantTrack.chrom2,
+                                         variantTrack.stop, variantTrack.rid, label, variantTrack.vartype);
                 }
             }
             break;
         }
     }
 
-    void GwVariantTrack::iterateToIndex(int targetIndex) {
-        int currentIndex = multiRegions.size();
-        if (targetIndex > currentIndex) {
-            nextN(targetIndex - currentIndex);
+    bool GwVariantTrack::hasRecord(int index) const {
+        return type == IMAGES || (index < (int)multiLabels.size() && !multiLabels[index].chrom.empty());
+    }
+
+    void GwVariantTrack::loadRange(int first, int last) {
+        if (type == IMAGES || last <= first) {
+            return;
+        }
+        const std::vector<int64_t> *offsets = nullptr;
+        if (type == VCF && recordOffsets && recordOffsets->ready.load(std::memory_order_acquire) &&
+            !recordOffsets->offsets.empty()) {
+            offsets = &recordOffsets->offsets;
+        }
+        int missing = first;
+        while (missing < last && missing < (int)multiRegions.size() && !multiRegions[missing].empty()) {
+            ++missing;
+        }
+        if (missing < last && !(offsets && missing >= (int)offsets->size())) {  // else only past the last record
+            if (offsets && (missing != nextIndex || vcf.done) && vcf.seek((*offsets)[missing])) {
+                nextIndex = missing;
+            }
+            // Without offsets the reader can only go forward, reading every record on the way as before
+            if (nextIndex <= missing) {
+                nextN(last - nextIndex);
+            }
+        }
+        if (!offsets) {
+            return;
+        }
+        if (last >= (int)offsets->size()) {
+            vcf.done = true;  // stops paging past the last record, as reaching the end of the file does
+        }
+        const int keep = 4 * (last - first);
+        for (int i = 0; i < (int)multiRegions.size(); ++i) {
+            if ((i < first - keep || i >= last + keep) && !multiRegions[i].empty()) {
+                std::vector<Utils::Region>().swap(multiRegions[i]);
+            }
         }
     }
 
@@ -2872,16 +3571,6 @@ namespace HGW {
             return;
         }
 
-        std::unordered_set<std::string> seen;
-        seen.reserve(multiLabels.size() + 32);
-        for (size_t i = 0; i < multiLabels.size() && i < multiRegions.size(); ++i) {
-            const auto &regions = multiRegions[i];
-            const auto &lbl = multiLabels[i];
-            std::string chrom2 = regions.size() > 1 ? regions[1].chrom : lbl.chrom;
-            long stop = regions.size() > 1 ? regions[1].markers[0].first : (regions.empty() ? lbl.pos : regions[0].markers[0].second);
-            seen.insert(makeVariantSearchKey(lbl.chrom, lbl.pos, chrom2, stop, lbl.variantId));
-        }
-
         std::optional<Utils::Region> queryRegion;
         try {
             Utils::Region parsed = Utils::parseRegion(trimmed);
@@ -2892,8 +3581,12 @@ namespace HGW {
         }
         std::string queryLower = toLowerCopy(trimmed);
 
-        auto appendIfMatch = [&](std::string &chrom, long start, std::string &chrom2, long stop,
+        // Matches are stored at their record number, so they line up with the pages read later
+        auto appendIfMatch = [&](int index, std::string &chrom, long start, std::string &chrom2, long stop,
                                  std::string &rid, std::string &label, std::string &vartype) {
+            if (hasRecord(index)) {
+                return;
+            }
             bool keep = false;
             if (queryRegion.has_value()) {
                 keep = regionOverlapsVariant(*queryRegion, chrom, start, stop, chrom2);
@@ -2912,12 +3605,7 @@ namespace HGW {
             if (!keep) {
                 return;
             }
-            std::string key = makeVariantSearchKey(chrom, start, chrom2, stop, rid);
-            if (seen.find(key) != seen.end()) {
-                return;
-            }
-            seen.insert(key);
-            appendVariantSite(chrom, start, chrom2, stop, rid, label, vartype);
+            setVariantSite(index, chrom, start, chrom2, stop, rid, label, vartype);
         };
 
         if (type == VCF) {
@@ -2925,12 +3613,13 @@ namespace HGW {
             reader.cacheStdin = false;
             reader.label_to_parse = m_opts->parse_label.c_str();
             reader.open(path);
+            int index = 0;
             while (!reader.done) {
                 reader.next();
                 if (reader.done) {
                     break;
                 }
-                appendIfMatch(reader.chrom, reader.start, reader.chrom2, reader.stop,
+                appendIfMatch(index++, reader.chrom, reader.start, reader.chrom2, reader.stop,
                               reader.rid, reader.label, reader.vartype);
             }
             return;
@@ -2940,18 +3629,19 @@ namespace HGW {
         reader.track_label_parser_rules = variantTrack.track_label_parser_rules;
         reader.open(path, false);
         reader.fetch(nullptr);
+        int index = 0;
         while (!reader.done) {
             reader.next();
             if (reader.done) {
                 break;
             }
             std::string label = reader.gene_name;
-            appendIfMatch(reader.chrom, reader.start, reader.chrom2, reader.stop,
+            appendIfMatch(index++, reader.chrom, reader.start, reader.chrom2, reader.stop,
                           reader.rid, label, reader.vartype);
         }
     }
 
-    void GwVariantTrack::appendVariantSite(std::string &chrom, long start, std::string &chrom2, long stop, std::string &rid, std::string &label, std::string &vartype) {
+    void GwVariantTrack::setVariantSite(int index, std::string &chrom, long start, std::string &chrom2, long stop, std::string &rid, std::string &label, std::string &vartype) {
         long rlen = stop - start;
         std::vector<Utils::Region> v;
         bool isTrans = chrom != chrom2;
@@ -2977,136 +3667,177 @@ namespace HGW {
             r2->end = stop + m_opts->pad;
             r2->markers = {{stop, stop}};
         }
-        multiRegions.push_back(v);
+        if (index >= (int)multiRegions.size()) {
+            multiRegions.resize(index + 1);
+            multiLabels.resize(index + 1);  // placeholders have an empty chrom
+        }
+        multiRegions[index] = std::move(v);
+        if (!multiLabels[index].chrom.empty()) {
+            return;  // read before, keep whatever label was chosen
+        }
         if (inputLabels->contains(rid)) {
-            multiLabels.push_back((*inputLabels)[rid]);
+            multiLabels[index] = (*inputLabels)[rid];
         } else {
-            multiLabels.push_back(Utils::makeLabel(chrom, start, label, labelChoices, rid, vartype, "", false, false, empty_comment));
+            multiLabels[index] = Utils::makeLabel(chrom, start, label, labelChoices, rid, vartype, "", false, false, empty_comment);
         }
     }
 
     void collectGFFTrackData(HGW::GwTrack &trk, std::vector<Utils::TrackBlock> &features) {
-        // For GFF convert all child features into TrackBlocks
-        ankerl::unordered_dense::map< std::string, std::vector< std::shared_ptr<Utils::GFFTrackBlock> > > gffParentMap;
-        std::vector< std::shared_ptr<Utils::GFFTrackBlock> > gffBlocks;
-        while (true) {
-            trk.next();
-            if (trk.done) {
-                break;
-            }
-            if (trk.parent.empty()) {
+        // Child features are grouped into transcripts by the interned parent id of their record. Children
+        // are gathered in one flat vector, bucketed by parent, and each transcript is written once into
+        // a TrackBlock left by the previous frame, so assembling a dense region does not allocate per feature
+        enum Part : uint8_t { OTHER, EXON, CDS, GENE, MRNA, START_CODON, STOP_CODON };
+        struct Child {
+            const FeatureRecord *r;
+            uint32_t group;
+            Part part;
+        };
+        thread_local std::vector<Child> children;
+        thread_local std::vector<uint32_t> groupStart;
+        thread_local std::vector<Child> sorted;
+        children.clear();
+        ankerl::unordered_dense::map<uint32_t, uint32_t> groupOf;  // parent id -> group, in order of first appearance
+        ankerl::unordered_dense::map<uint32_t, Part> partOf;  // vartype id -> part
+        const FeatureStore *st = trk.store.get();
+        while (const FeatureRecord *r = trk.nextRecord()) {
+            if (r->parent == 0) {  // no parent
                 continue;
             }
-            gffBlocks.push_back(std::make_shared<Utils::GFFTrackBlock>());
-            std::shared_ptr<Utils::GFFTrackBlock> g = gffBlocks.back();
-            g->chrom = trk.chrom;
-            g->start = trk.start;
-            g->end = trk.stop;
-            if (!trk.rid.empty()) {
-               g->name = trk.rid;
-            } else {
-               g->name = trk.parent;
+            auto g = groupOf.try_emplace(r->parent, (uint32_t)groupOf.size()).first->second;
+            auto p = partOf.find(r->vartype);
+            if (p == partOf.end()) {
+                const std::string_view v = st->str(r->vartype);
+                const Part part = (v == "exon") ? EXON : (v == "CDS") ? CDS : (v == "gene") ? GENE : (v == "mRNA") ? MRNA :
+                                  (v == "start_codon") ? START_CODON : (v == "stop_codon") ? STOP_CODON : OTHER;
+                p = partOf.emplace(r->vartype, part).first;
             }
-            g->vartype = trk.vartype;
-            g->strand = (trk.parts[6] == "-") ? 2 : 1; // assume all on same strand
-            g->parts.insert(g->parts.end(), trk.parts.begin(), trk.parts.end());
-            gffParentMap[trk.parent].push_back(g);
+            children.push_back({r, g, p->second});
         }
-        
-        features.resize(gffParentMap.size());
-        int i = 0;
-        for (auto &pg : gffParentMap) {
-            int j = 0;
-            Utils::TrackBlock &track = features[i];
-            // std::sort(pg.second.begin(), pg.second.end(),
-            //           [](const std::shared_ptr<Utils::GFFTrackBlock> &a, const std::shared_ptr<Utils::GFFTrackBlock> &b)-> bool
-            //           { return ( (a->start < b->start) || 
-            //             (a->start == b->start && (a->end < b->end || a->vartype != "exon")
-            //           ));
-            //           });
-            std::sort(pg.second.begin(), pg.second.end(),
-          [](const std::shared_ptr<Utils::GFFTrackBlock> &a, const std::shared_ptr<Utils::GFFTrackBlock> &b)-> bool
-          { 
-              return ( (a->start < b->start) || 
-                       (a->start == b->start && 
-                        ((a->end < b->end) || 
-                         (a->end == b->end && a->vartype != "exon" && b->vartype == "exon")
-                        )
-                       )
-              );
-          });
-
+        const size_t nGroups = groupOf.size();
+        // Counting sort of children by group, keeping file order within a group
+        groupStart.assign(nGroups + 1, 0);
+        for (const auto &c : children) {
+            groupStart[c.group + 1] += 1;
+        }
+        for (size_t g = 0; g < nGroups; ++g) {
+            groupStart[g + 1] += groupStart[g];
+        }
+        sorted.resize(children.size());
+        {
+            std::vector<uint32_t> fill(groupStart.begin(), groupStart.end() - 1);
+            for (const auto &c : children) {
+                sorted[fill[c.group]++] = c;
+            }
+        }
+        auto unquote = [](std::string &str) {
+            if (!str.empty() && str.front() == '"') {
+                str.erase(0, 1);
+            }
+            if (!str.empty() && str.back() == '"') {
+                str.erase(str.size() - 1, 1);
+            }
+        };
+        if (features.size() < nGroups) {
+            features.resize(nGroups);
+        }
+        for (size_t g = 0; g < nGroups; ++g) {
+            auto first = sorted.begin() + groupStart[g];
+            auto last = sorted.begin() + groupStart[g + 1];
+            std::sort(first, last, [](const Child &a, const Child &b) -> bool {
+                if (a.r->start != b.r->start) {
+                    return a.r->start < b.r->start;
+                }
+                if (a.r->end != b.r->end) {
+                    return a.r->end < b.r->end;
+                }
+                return a.part != EXON && b.part == EXON;
+            });
+            const size_t n = (size_t)(last - first);
+            Utils::TrackBlock &track = features[g];
+            const FeatureRecord &head = *first->r;
+            track.chrom = st->str(head.chrom);
+            track.start = head.start;
+            track.end = head.end;
+            track.strand = (head.strand == 2) ? 2 : 1;  // assume all on same strand
+            const std::string_view headName = st->text(head.name);
+            track.name = (headName.empty()) ? st->str(head.parent) : headName;
+            unquote(track.name);
+            track.parent = st->str(head.parent);
+            unquote(track.parent);
+            track.line.clear();
+            track.vartype.clear();
+            track.unique_id.clear();
+            track.coding_start = -1;
+            track.coding_end = -1;
+            track.level = 0;
+            track.value = 0;
             track.anyToDraw = false;
-            bool between_codons = false;
-            for (auto &g: pg.second) {
-                if (j == 0) {
-                    track.chrom = g->chrom;
-                    track.start = g->start;
-                    track.name = g->name;
-
-                    if (track.name.front() == '"') {
-                        track.name.erase(0, 1);
-                    }
-                    if (track.name.back() == '"') {
-                        track.name.erase(track.name.size() - 1, 1);
-                    }
-                    track.parent = pg.first;
-                    if (track.parent.front() == '"') {
-                        track.parent.erase(0, 1);
-                    }
-                    if (track.parent.back() == '"') {
-                        track.parent.erase(track.parent.size() - 1, 1);
-                    }
-                    track.end = g->end;
-                    track.strand = g->strand;
-
-                } else if (g->end > track.end) {
-                    track.end = g->end;
-                }
-                track.parts.insert(track.parts.end(), g->parts.begin(), g->parts.end());
-                track.parts.push_back("\n");
-                track.s.push_back(g->start);
-                track.e.push_back(g->end);
-
-                if (g->vartype == "CDS") {
-                    track.anyToDraw = true;
-                    track.drawThickness.push_back(2);  // fat line
-                } else if (g->vartype == "gene") {
-                    track.drawThickness.push_back(3);  // border only
-                } else if (g->vartype == "exon" || g->vartype == "mRNA" || g->vartype == "gene") {
-                    track.drawThickness.push_back(2);  // no line
-                    if (!track.anyToDraw) { track.anyToDraw = true; }
-                } else if (g->vartype == "start_codon") {
-                    between_codons = !between_codons;
-                    track.coding_start = g->start;
-                    track.drawThickness.push_back(0);
-                } else if (g->vartype == "stop_codon") {
-                    between_codons = !between_codons;
-                    track.coding_end = g->end;
-                    track.drawThickness.push_back(0);
-                } else {
-                    track.drawThickness.push_back(1);
-                    if (!track.anyToDraw) { track.anyToDraw = true; }
+            track.parts.resize(n);
+            track.s.resize(n);
+            track.e.resize(n);
+            track.drawThickness.resize(n);
+            size_t j = 0;
+            for (auto it = first; it != last; ++it, ++j) {
+                const FeatureRecord &r = *it->r;
+                track.end = std::max(track.end, r.end);
+                track.parts[j] = st->text(r.line);  // one raw line per child, split when a popup needs it
+                track.s[j] = r.start;
+                track.e[j] = r.end;
+                switch (it->part) {
+                    case CDS:
+                    case EXON:
+                    case MRNA:
+                        track.drawThickness[j] = 2;  // fat line
+                        track.anyToDraw = true;
+                        break;
+                    case GENE:
+                        track.drawThickness[j] = 3;  // border only
+                        break;
+                    case START_CODON:
+                        track.coding_start = r.start;
+                        track.drawThickness[j] = 0;
+                        break;
+                    case STOP_CODON:
+                        track.coding_end = r.end;
+                        track.drawThickness[j] = 0;
+                        break;
+                    default:
+                        track.drawThickness[j] = 1;
+                        track.anyToDraw = true;
+                        break;
                 }
-                j += 1;
             }
-            i += 1;
         }
+        features.resize(nGroups);
     }
     void collectTrackData(HGW::GwTrack &trk, std::vector<Utils::TrackBlock> &features) {
         bool isVCF = trk.kind == HGW::VCF_NOI || trk.kind == HGW::BCF_IDX || trk.kind == HGW::VCF_IDX;
+        // Blocks left in features by the previous frame are overwritten in place, so their strings
+        // and vectors keep their capacity and redrawing a dense track does not allocate
+        size_t used = 0;
         while (true) {
             trk.next();
             if (trk.done) {
                 break;
             }
-            // check for big bed. BED_IDX will already be split, BED_NOI is split here
-            if (trk.kind == HGW::BED_NOI) {
-                trk.parts.clear();
-                Utils::split(trk.variantString, '\t', trk.parts);
-            }
-            features.resize(features.size() + 1);
-            Utils::TrackBlock *b = &features.back();
+            // check for big bed. BED lines are split here
+            if (trk.kind == HGW::BED_NOI || trk.kind == HGW::BED_IDX || trk.kind == HGW::BIGBED) {
+                Utils::splitInto(trk.variantString, '\t', trk.parts, true);
+            }
+            if (used == features.size()) {
+                features.emplace_back();
+            }
+            Utils::TrackBlock *b = &features[used++];
+            b->vartype.clear();
+            b->parent.clear();
+            b->unique_id.clear();
+            b->coding_start = -1;
+            b->coding_end = -1;
+            b->level = 0;
+            b->value = 0;
+            b->s.clear();
+            b->e.clear();
+            b->drawThickness.clear();
             b->chrom = trk.chrom;
             b->name = trk.rid;
             b->start = trk.start;
@@ -3147,31 +3878,30 @@ namespace HGW {
                 tryBed12 = !trk.parts.empty() && trk.parts.size() >= 12;
             }
             if (tryBed12) {
-                std::vector<std::string> lens, starts;
-                Utils::split(trk.parts[blockSizesIdx], ',', lens);
-                Utils::split(trk.parts[blockStartsIdx], ',', starts);
-                if (starts.size() != lens.size()) {
+                // Comma separated block lists; the trailing comma of UCSC files gives an empty last field
+                constexpr int maxBlocks = 4096;
+                static thread_local std::vector<std::string_view> lens(maxBlocks), starts(maxBlocks);
+                const int nLens = Utils::splitView(trk.parts[blockSizesIdx], ',', lens.data(), maxBlocks, true);
+                const int nStarts = Utils::splitView(trk.parts[blockStartsIdx], ',', starts.data(), maxBlocks, true);
+                if (nStarts != nLens) {
                     continue;
                 }
-                int target = (int)lens.size();
+                int target = nLens;
                 int gene_start = trk.start;
                 int thickStart, thickEnd;
-                try {
-                    thickStart = std::stoi(trk.parts[thickStartIdx]);
-                    thickEnd = (std::stoi(trk.parts[thickEndIdx]));
-                } catch (...) {
+                if (!Utils::parseInt(trk.parts[thickStartIdx], thickStart) ||
+                    !Utils::parseInt(trk.parts[thickEndIdx], thickEnd)) {
                     continue;
                 }
                 b->drawThickness.resize(target, 0);
                 thickEnd = (thickEnd == thickStart) ? trk.stop : thickEnd;
                 for (int i=0; i < target; ++i) {
                     int s, e;
-                    try {
-                        s = gene_start + std::stoi(starts[i]);
-                        e = s + std::stoi(lens[i]);
-                    } catch (...) {
+                    if (!Utils::parseInt(starts[i], s) || !Utils::parseInt(lens[i], e)) {
                         break;
                     }
+                    s += gene_start;
+                    e += s;
                     if (s >= thickStart && e <= thickEnd) {
                         b->drawThickness[i] = 2;
                     } else {
@@ -3183,6 +3913,7 @@ namespace HGW {
                 }
             }
         }
+        features.resize(used);
     }
 
 }
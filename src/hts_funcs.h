@@ -4,6 +4,12 @@
 
 #pragma once
 
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -15,6 +21,7 @@
 #include "htslib/tbx.h"
 
 namespace Drawing { struct drawContext; }
+namespace BS { class thread_pool; }
 
 #include "parser.h"
 //#include "IITree.h"
@@ -25,6 +32,7 @@ namespace Drawing { struct drawContext; }
 #include "glob_cpp.hpp"
 #include "segments.h"
 #include "themes.h"
+#include "track_cache.h"
 
 
 namespace HGW {
@@ -37,7 +45,7 @@ namespace HGW {
          BED_IDX,
          VCF_IDX,
          BCF_IDX,
-         VCF_NOI,  // NOI for no index. All are > BCF_IDX
+         VCF_NOI,  // NOI for no index
          BED_NOI,
          GFF3_NOI,
          GTF_NOI,
@@ -46,8 +54,19 @@ namespace HGW {
          STDIN,
          ROI,
          INTRON,   // synthetic track: splice introns extracted from a BAM ReadCollection
+         PAF_IDX,  // values are stored in .gwc/.gwn caches, so new kinds go last
     };
 
+    // Kinds read whole into memory rather than fetched by region through an index
+    inline bool isNonIndexed(FType kind) {
+        switch (kind) {
+            case BIGWIG: case BIGBED: case GFF3_IDX: case GTF_IDX: case BED_IDX: case PAF_IDX: case VCF_IDX: case BCF_IDX:
+                return false;
+            default:
+                return true;
+        }
+    }
+
     void guessRefGenomeFromBam(std::string &inputName, Themes::IniOptions &opts, std::vector<std::string> &bam_paths, std::vector<Utils::Region> &regions);
 
     void print_BCF_IDX(hts_idx_t *idx_v, bcf_hdr_t *hdr, std::string &chrom, int pos, htsFile *fp, std::string &id_str, std::string &variantString);
@@ -56,7 +75,7 @@ namespace HGW {
 
     void print_VCF_IDX(std::string &path, std::string &id_str, std::string &chrom, int pos, std::string &varinatString);
 
-	void print_cached(std::vector<Utils::TrackBlock> &vals, std::string &chrom, int pos, bool flat, std::string &varinatString);
+	void print_cached(const std::vector<FeatureRecord> &vals, const FeatureStore &store, int pos, std::string &varinatString);
 
     /*
     * VCF or BCF file reader only. Cache's lines from stdin or non-indexed file. Can parse labels from file
@@ -87,6 +106,8 @@ namespace HGW {
 
         void open(const std::string &f);
         void next();
+        // Continues reading from a record offset found by a separate scan of the same file
+        bool seek(int64_t offset);
         void printTargetRecord(std::string &id_str, std::string &chrom, int pos);
 		void get_samples();
 
@@ -97,6 +118,11 @@ namespace HGW {
                                  bool coverage, std::vector<Parse::Parser> &filters, BS::thread_pool &pool,
                                  const int parse_mods, const bool add_soft_clip_space);
 
+    // As collectReadsAndCoverage, but the reads overlapping region are copied from window, a collection
+    // already read over a wider span of the same chromosome without filters
+    void collectWindowReadsAndCoverage(Segs::ReadCollection &col, const Segs::ReadCollection &window, sam_hdr_t *hdr_ptr,
+                                       Utils::Region *region, bool coverage, std::vector<Parse::Parser> &filters);
+
     void iterDrawParallel(Segs::ReadCollection &col, htsFile *b, sam_hdr_t *hdr_ptr, hts_idx_t *index, int threads,
                           Utils::Region *region, bool coverage, std::vector<Parse::Parser> &filters,
                           Themes::IniOptions &opts, SkCanvas *canvas,
@@ -120,10 +146,13 @@ namespace HGW {
     struct EndIdx {
         int end, size, index;
     };
+    class TrackLoader;
+
     /*
     * VCF/BCF/BED/GFF3/LABEL file reader. No label parsing for vcf/bcf.
-    * Non-indexed files are cached using TrackBlock items. Files with an index are fetched during drawing.
-    * Can also have no file associated with it, just an array of TrackBlock (used for roi drawing)
+    * Non-indexed files are cached using FeatureRecord items. Files with an index are read in windows around the
+    * drawn region, which are kept in fetchCache, and in the interactive window are read by a TrackLoader.
+    * Can also have no file associated with it, just blocks added with addBlock (used for roi drawing)
     */
     class GwTrack {
     public:
@@ -147,6 +176,7 @@ namespace HGW {
         bool add_to_dict; // add to dict of interval tree in file has no index, or process in stream
 
         FType kind;  // VCF_IDX,BED_NOI etc
+        bool pafByQuery{false};  // PAF_IDX tabix index built on query columns (-s1 -b3 -e4), not target
 
         htsFile *fp;
         tbx_t *idx_t;
@@ -161,20 +191,37 @@ namespace HGW {
         std::shared_ptr<std::istream> fpu;
         std::string tp;
 
-        int current_iter_index;
-        int num_intervals;
         bigWigFile_t *bigWig_fp;
-        bwOverlappingIntervals_t *bigWig_intervals;
-        bbOverlappingEntries_t *bigBed_entries;
+        bwOverlappingIntervals_t *bigWig_intervals;  // owned by bigWigCache
+        uint32_t bigWig_begin{0}, bigWig_end{0};  // intervals of bigWig_intervals within the padded region
+        float bigWig_basesPerPixel{1};  // set before fetch, wide views are read from the matching zoom level
 
         int region_end;
         std::vector<std::string> parts;  // string split by delimiter
 
-        std::vector<Utils::TrackBlock>::iterator vals_end;
-        std::vector<Utils::TrackBlock>::iterator iter_blk;
-
-        ankerl::unordered_dense::map< std::string, SuperIntervals<int, Utils::TrackBlock>> allBlocks;
-        std::vector<Utils::TrackBlock> overlappingBlocks, allBlocks_flat;
+        // Positions in fetchedBlocks->data of the features found by fetch. SuperIntervals reports
+        // them in descending order, so they are iterated in reverse
+        std::vector<size_t>::const_reverse_iterator vals_end;
+        std::vector<size_t>::const_reverse_iterator iter_blk;
+
+        ankerl::unordered_dense::map< std::string, SuperIntervals<int, FeatureRecord>> allBlocks;
+        std::vector<size_t> overlappingBlocks;
+        const SuperIntervals<int, FeatureRecord> *fetchedBlocks{nullptr};  // allBlocks entry of the last fetch
+        std::shared_ptr<FeatureStore> store;  // strings of the records in allBlocks
+        std::shared_ptr<MappedTrackFile> mappedBlocks;  // binary sidecar, chroms are moved into allBlocks on first fetch
+        // Records of a non-indexed track loaded whole, moved out of allBlocks by shareBlocks so that other plots,
+        // e.g. those drawing tiles, read them without a copy of their own. Never changed once shared
+        struct SharedBlocks {
+            ankerl::unordered_dense::map< std::string, SuperIntervals<int, FeatureRecord>> blocks;
+            std::shared_ptr<FeatureStore> store;
+        };
+        std::shared_ptr<const SharedBlocks> sharedBlocks;  // read instead of allBlocks when set
+        std::string indexedCopy;  // plain VCF opened as VCF_IDX through its copy, see indexedVcfCopyPath
+        std::shared_ptr<const FeatureNameIndex> nameIndex;  // built on the first search, or in the background by GwPlot
+        WindowCache<FeatureWindow> fetchCache;  // recent windows of tabix and BCF tracks
+        WindowCache<std::shared_ptr<bwOverlappingIntervals_t>> bigWigCache;
+        std::shared_ptr<TrackLoader> loader;  // set for interactive use, cache misses are then read in the background
+        bool loading{false};  // the last fetch is waiting for loader, nothing to draw yet
 
         Utils::TrackBlock block;
         bool done;
@@ -187,21 +234,101 @@ namespace HGW {
         double height_fraction{0};  // 0 = use default share; >0 = this track's fraction of canvas height
 
         void setPaint(SkPaint &faceColour);
-        void open(const std::string &p, bool add_to_dict);
+        // Large non-indexed files are parsed in chunks on pool, at most one per thread of pool
+        void open(const std::string &p, bool add_to_dict, BS::thread_pool *pool = nullptr);
+        // Opens p with records already loaded by another track, shared or read from its sidecar, instead of
+        // parsing the file again
+        void openLoaded(const std::string &p, FType k, std::shared_ptr<const SharedBlocks> shared,
+                        std::shared_ptr<MappedTrackFile> mapped);
+        // nullptr unless this is a file track whose records are all in memory
+        std::shared_ptr<const SharedBlocks> shareBlocks();
+        void addBlock(const Utils::TrackBlock &b);  // adds to allBlocks, index() must be called after
         void close();
         void clear();
         void fetch(const Utils::Region *rgn);
         void next();
-        bool findFeature(std::string &feature, Utils::Region &region);
+        // Like next, for tracks served from fetchedBlocks, but returns the record itself (strings are
+        // in *store) without copying its fields. nullptr once done
+        const FeatureRecord *nextRecord();
+        // Exact name lookup, partial also allows names containing feature on non-indexed tracks
+        bool findFeature(std::string &feature, Utils::Region &region, bool partial = true);
+        void buildNameIndex();  // sets nameIndex, reading or scanning the file if needed
+        // Names from the file or its sidecars only, so this can run on another thread. Returns nullptr
+        // for tracks whose names are only held in allBlocks, buildNameIndex handles those
+        static std::shared_ptr<const FeatureNameIndex> readNameIndex(const std::string &path, FType kind, const std::string &labelRules,
+                                                                     const std::shared_ptr<MappedTrackFile> &mapped);
         void parseVcfRecord(Utils::TrackBlock &b);
         void parseVcfRecord();
         void printTargetRecord(std::string &id_str, std::string &chrm, int pos);
+        bool adoptLoaded();  // moves windows finished by loader into the caches, true if there were any
+
+    private:
+        friend class TrackLoader;
+        void loadBlocks(BS::thread_pool *pool);
+        void resetFetched();
+        void fetchWindow(const Utils::Region *rgn);
+        FeatureWindow readWindow(const std::string &windowChrom, int windowStart, int windowEnd);
+        void fetchBigWig(const Utils::Region *rgn);
+        // zoomLevel -1 reads one value per base, otherwise the summary records of that zoom level
+        std::shared_ptr<bwOverlappingIntervals_t> readBigWigWindow(const std::string &windowChrom, int windowStart, int windowEnd,
+                                                                    int zoomLevel);
+        bool openCachedBlocks();
+        void saveCachedBlocks();
+        bool openIndexedVcfCopy();
+        void loadCachedChrom(const std::string &chrom);
+    };
+
+    // Reads windows of indexed tracks (tabix, BCF, bigWig, bigBed) on a worker thread so that drawing
+    // never waits on a slow or remote file. The worker has its own GwTrack opened on the same path.
+    // Finished windows are collected on the main thread with GwTrack::adoptLoaded, and notify is
+    // called from the worker so that the UI can wake up and redraw
+    class TrackLoader {
+    public:
+        struct Loaded {
+            std::string chrom;
+            int start, end;
+            int zoomLevel;
+            size_t bytes;
+            FeatureWindow features;
+            std::shared_ptr<bwOverlappingIntervals_t> bigWig;
+        };
+
+        TrackLoader(BS::thread_pool &pool, std::function<void()> notify);
+
+        static bool supports(FType kind);
+
+        // Queues a window of owner. A queued window that has not started yet is replaced
+        void request(const GwTrack &owner, const std::string &chrom, int start, int end, int zoomLevel = -1);
+        std::vector<Loaded> take();
+
+    private:
+        struct Window {
+            std::string chrom;
+            int start, end;
+            int zoomLevel;
+        };
+        struct State {
+            std::mutex mtx;
+            std::string path, labelRules;
+            bool running{false};
+            bool failed{false};
+            std::optional<Window> queued, active;
+            std::vector<Loaded> finished;
+            std::unique_ptr<GwTrack> reader;  // only used by the worker
+            std::function<void()> notify;
+            ~State();
+        };
+        BS::thread_pool &pool;
+        std::shared_ptr<State> state;  // shared with a running task, which can outlive the track
+
+        static void run(const std::shared_ptr<State> &state);
     };
 
     bool searchTracks(std::vector<GwTrack> &tracks, std::string &feature, Utils::Region &region);
 
     void collectGFFTrackData(GwTrack &trk, std::vector<Utils::TrackBlock> &features);
 
+    // Replaces features with the blocks of the last fetch, reusing the existing elements
     void collectTrackData(GwTrack &trk, std::vector<Utils::TrackBlock> &features);
 
 //    void saveVcf(VCFfile &input_vcf, std::string path, std::vector<Utils::Label> multiLabels);
@@ -243,12 +370,29 @@ namespace HGW {
         Themes::IniOptions *m_opts;
 
         void nextN(int number);
-        void iterateToIndex(int index);
+        // Makes the records [first, last) resident. Once the background scan of record offsets is done,
+        // missing records are read from their offset, and the regions of records more than a few pages
+        // away are released, so jumping to any page only parses that page. Labels are always kept
+        void loadRange(int first, int last);
+        // False for the placeholder entries of records not read yet, e.g. those before a search match
+        bool hasRecord(int index) const;
         void appendImageLabels(int startIdx, int number);  // adds labels for use with IMAGES only
         void appendSearchMatches(const std::string &query);
 
     private:
-        void appendVariantSite(std::string &chrom, long start, std::string &chrom2, long stop, std::string &rid, std::string &label, std::string &vartype);
+        // Filled by a scan task that it owns, shared so that the track stays copyable. The last copy
+        // of the track to go cancels the scan and waits for it
+        struct RecordOffsets {
+            std::vector<int64_t> offsets;
+            std::atomic<bool> ready{false};
+            std::atomic<bool> cancel{false};
+            std::future<void> scan;
+            ~RecordOffsets();
+        };
+        std::shared_ptr<RecordOffsets> recordOffsets;
+        int nextIndex{0};  // record number that the next read returns
+
+        void setVariantSite(int index, std::string &chrom, long start, std::string &chrom2, long stop, std::string &rid, std::string &label, std::string &vartype);
     };
 
 }
@@ -1,10 +1,12 @@
 
 #include <algorithm>
+#include <atomic>
 #include <filesystem>
 #include <htslib/faidx.h>
 #include <iostream>
 #include <mutex>
 #include <string>
+#include <unordered_map>
 #include "argparse.h"
 #include "BS_thread_pool.h"
 #include "cli_interface.h"
@@ -46,7 +48,6 @@
 // skia context has to be managed from global space
 GrDirectContext *sContext = nullptr;
 SkSurface *sSurface = nullptr;
-std::mutex mtx;
 
 #ifdef __EMSCRIPTEN__
 // Global plot pointer so the exported resize notification can reach it.
@@ -583,8 +584,7 @@ int main(int argc, char *argv[]) {
                         managers.push_back(m);
                     }
 
-                    std::vector<std::vector<Utils::Region> > jobs(iopts.threads);
-                    int part = 0;
+                    std::vector<Utils::Region> jobs;
                     int min_chrom_size = program.get<int>("--min-chrom-size");
                     for (int i = 0; i < faidx_nseq(managers[0]->fai); ++i) {
                         const char *chrom = faidx_iseq(managers[0]->fai, i);
@@ -596,47 +596,47 @@ int main(int argc, char *argv[]) {
                         N.chrom = chrom;
                         N.start = 1;
                         N.end = seq_len;
-                        jobs[part].push_back(N);
-                        part = (part == (int) jobs.size() - 1) ? 0 : part + 1;
+                        jobs.push_back(N);
                     }
+                    // Largest first, so that the last chromosomes to be started are the quick ones
+                    std::stable_sort(jobs.begin(), jobs.end(), [](const Utils::Region &a, const Utils::Region &b) {
+                        return a.end - a.start > b.end - b.start;
+                    });
 
+                    // Each task owns a manager and takes the next chromosome until none are left
                     int ts = std::min(iopts.threads, (int) jobs.size());
                     BS::thread_pool pool(ts);
-                    int block = 0;
-                    pool.parallelize_loop(0, jobs.size(),
-                                          [&](const int a, const int b) {
-                                              mtx.lock();
-                                              int this_block = block;
-                                              block += 1;
-                                              mtx.unlock();
-                                              Manager::GwPlot *plt = managers[this_block];
-                                              plt->makeRasterSurface();
-                                              std::vector<Utils::Region> &all_regions = jobs[this_block];
-
-                                              for (auto &rgn: all_regions) {
-                                                  plt->collections.clear();
-                                                  free(const_cast<char*>(plt->regions[0].refSeq));
-                                                  plt->regions[0].refSeq = nullptr;
-                                                  plt->regions[0].chrom = rgn.chrom;
-                                                  plt->regions[0].start = rgn.start;
-                                                  plt->regions[0].end = rgn.end;
-                                                  if (!options.extra_commands.empty()) {
-                                                      for (const auto& command: options.extra_commands) {
-                                                          plt->inputText = command;
-                                                          plt->commandProcessed();
-                                                      }
-                                                  }
-                                                  plt->runDrawNoBuffer();
-
-                                                  sk_sp<SkImage> img(plt->rasterSurface->makeImageSnapshot());
-                                                  std::filesystem::path fname = "GW~" + plt->regions[0].chrom + "~" +
-                                                                   std::to_string(plt->regions[0].start) + "~" +
-                                                                   std::to_string(plt->regions[0].end) + "~.png";
-                                                  std::filesystem::path out_path = options.outdir / fname;
-                                                  Manager::imageToPng(img, out_path);
-                                              }
-                                          })
-                            .wait();
+                    std::atomic<size_t> nextJob{0};
+                    for (int t = 0; t < ts; ++t) {
+                        pool.push_task([&, t]() {
+                            Manager::GwPlot *plt = managers[t];
+                            plt->makeRasterSurface();
+                            for (size_t j = nextJob++; j < jobs.size(); j = nextJob++) {
+                                Utils::Region &rgn = jobs[j];
+                                plt->collections.clear();
+                                free(const_cast<char*>(plt->regions[0].refSeq));
+                                plt->regions[0].refSeq = nullptr;
+                                plt->regions[0].chrom = rgn.chrom;
+                                plt->regions[0].start = rgn.start;
+                                plt->regions[0].end = rgn.end;
+                                if (!options.extra_commands.empty()) {
+                                    for (const auto& command: options.extra_commands) {
+                                        plt->inputText = command;
+                                        plt->commandProcessed();
+                                    }
+                                }
+                                plt->runDrawNoBuffer();
+
+                                sk_sp<SkImage> img(plt->rasterSurface->makeImageSnapshot());
+                                std::filesystem::path fname = "GW~" + plt->regions[0].chrom + "~" +
+                                                 std::to_string(plt->regions[0].start) + "~" +
+                                                 std::to_string(plt->regions[0].end) + "~.png";
+                                std::filesystem::path out_path = options.outdir / fname;
+                                Manager::imageToPng(img, out_path);
+                            }
+                        });
+                    }
+                    pool.wait_for_tasks();
 
                     for (auto &itm: managers) {
                         delete (itm);
@@ -692,6 +692,9 @@ int main(int argc, char *argv[]) {
                     m->setImageSize(iopts.dimensions.x, iopts.dimensions.y);
                     m->makeRasterSurface();
                     m->opts.threads = 1;
+                    for (auto *b: m->bams) {  // consecutive sites often fall in the same compressed blocks
+                        hts_set_cache_size(b, 16 << 20);
+                    }
                     for (auto &s: options.filters) {
                         m->addFilter(s);
                     }
@@ -702,6 +705,7 @@ int main(int argc, char *argv[]) {
                 }
 
                 std::vector<Manager::VariantJob> jobs;
+                std::unordered_map<std::string, int> chromOrder;
                 std::vector<std::string> empty_labels;
                 std::string dateStr;
 
@@ -728,54 +732,89 @@ int main(int argc, char *argv[]) {
                     job.stop = vcf.stop;
                     job.varType = vcf.vartype;
                     job.rid = vcf.rid;
+                    chromOrder.emplace(job.chrom, (int)chromOrder.size());
                     jobs.push_back(job);
                     if (writeLabel) {
                         Utils::Label l = Utils::makeLabel(vcf.chrom, vcf.start, vcf.label, empty_labels, vcf.rid, vcf.vartype, "", false, false, empty_comment);
                         Utils::labelToFile(fLabels, l, dateStr, fileName);
                     }
                 }
-                // shuffling might help distribute high cov regions between jobs
-                // std::shuffle(std::begin(jobs), std::end(jobs), std::random_device());
-                int ts = std::min(iopts.threads, (int)jobs.size());
+                // Sites are drawn in order of position, so that each manager takes a run of neighbouring sites.
+                // Chromosomes keep the order they first appear in the file
+                std::stable_sort(jobs.begin(), jobs.end(), [&](const Manager::VariantJob &a, const Manager::VariantJob &b) {
+                    if (a.chrom != b.chrom) {
+                        return chromOrder.at(a.chrom) < chromOrder.at(b.chrom);
+                    }
+                    return a.start < b.start;
+                });
+                // Sites whose padded regions overlap are drawn as a group. The reference, reads and indexed track
+                // windows of the span of the group are fetched once, see GwPlot::setReadWindow, and each site is
+                // drawn from the part overlapping it. Sites drawn as two regions are drawn on their own. Every site
+                // is drawn with buffered reads, so an image does not depend on whether the site was grouped
+                struct SiteGroup {
+                    size_t first, last;  // [first, last) of jobs
+                    int start, end;
+                };
+                const int maxGroupSpan = 50000;
+                auto singleRegion = [&](const Manager::VariantJob &job) {
+                    return job.chrom == job.chrom2 && job.stop - job.start <= iopts.split_view_size;
+                };
+                std::vector<SiteGroup> groups;
+                for (size_t i = 0; i < jobs.size(); ++i) {
+                    const Manager::VariantJob &job = jobs[i];
+                    const int siteStart = (int)std::max(1L, job.start - iopts.pad);  // as setVariantSite
+                    const int siteEnd = (int)job.stop + iopts.pad;
+                    if (!groups.empty() && singleRegion(job) && singleRegion(jobs[groups.back().first]) &&
+                        job.chrom == jobs[groups.back().first].chrom && siteStart <= groups.back().end &&
+                        std::max(groups.back().end, siteEnd) - groups.back().start <= maxGroupSpan) {
+                        groups.back().last = i + 1;
+                        groups.back().end = std::max(groups.back().end, siteEnd);
+                    } else {
+                        groups.push_back({i, i + 1, siteStart, siteEnd});
+                    }
+                }
+                // Each task owns a manager and takes the next few groups until none are left. Groups are taken in
+                // small runs so that neighbouring sites still tend to be drawn by the same manager
+                int ts = std::min(iopts.threads, (int)groups.size());
                 BS::thread_pool pool(ts);
-                int block = 0;
-                pool.parallelize_loop(0, jobs.size(),
-                                      [&](const int a, const int b) {
-                                            mtx.lock();
-                                            int this_block = block;
-                                            block += 1;
-                                            mtx.unlock();
-                                            Manager::GwPlot *plt = managers[this_block];
-
-//                                            sk_sp<SkSurface> rasterSurface = SkSurface::MakeRasterN32Premul(iopts.dimensions.x, iopts.dimensions.y);
-//                                            SkCanvas *canvas = rasterSurface->getCanvas();
-                                            for (int i = a; i < b; ++i) {
-                                                Manager::VariantJob job = jobs[i];
-                                                plt->setVariantSite(job.chrom, job.start, job.chrom2, job.stop);
-
-                                                bool stream_reads = iopts.link_op == 0;
-                                                if (!options.extra_commands.empty()) {
-                                                    plt->regionSelection = 0;
-                                                    for (const auto& command: options.extra_commands) {
-                                                        plt->inputText = command;
-                                                        plt->commandProcessed();
-                                                        if (plt->regions.front().sortOption != 0) {
-                                                            stream_reads = false;
-                                                        }
-                                                    }
-                                                }
-                                                if (stream_reads) {
-                                                    plt->runDrawNoBuffer();
-                                                } else {
-                                                    plt->runDraw();
-                                                }
-                                                sk_sp<SkImage> img(plt->rasterSurface->makeImageSnapshot());
-                                                std::filesystem::path fname = job.varType + "~" + job.chrom + "~" + std::to_string(job.start) + "~" + job.chrom2 + "~" + std::to_string(job.stop) + "~" + job.rid + ".png";
-                                                std::filesystem::path full_path = options.outdir / fname;
-                                                Manager::imageToPng(img, full_path);
-                                          }
-                                      })
-                        .wait();
+                const size_t runLength = 16;
+                std::atomic<size_t> nextGroup{0};
+                for (int t = 0; t < ts; ++t) {
+                    pool.push_task([&, t]() {
+                        Manager::GwPlot *plt = managers[t];
+                        for (size_t first = nextGroup.fetch_add(runLength); first < groups.size(); first = nextGroup.fetch_add(runLength)) {
+                            size_t last = std::min(first + runLength, groups.size());
+                            for (size_t g = first; g < last; ++g) {
+                                const SiteGroup &group = groups[g];
+                                const bool shared = group.last - group.first > 1;
+                                if (shared) {
+                                    plt->setReadWindow(jobs[group.first].chrom, group.start, group.end);
+                                }
+                                for (size_t i = group.first; i < group.last; ++i) {
+                                    Manager::VariantJob &job = jobs[i];
+                                    plt->setVariantSite(job.chrom, job.start, job.chrom2, job.stop);
+
+                                    if (!options.extra_commands.empty()) {
+                                        plt->regionSelection = 0;
+                                        for (const auto& command: options.extra_commands) {
+                                            plt->inputText = command;
+                                            plt->commandProcessed();
+                                        }
+                                    }
+                                    plt->runDraw();
+                                    sk_sp<SkImage> img(plt->rasterSurface->makeImageSnapshot());
+                                    std::filesystem::path fname = job.varType + "~" + job.chrom + "~" + std::to_string(job.start) + "~" + job.chrom2 + "~" + std::to_string(job.stop) + "~" + job.rid + ".png";
+                                    std::filesystem::path full_path = options.outdir / fname;
+                                    Manager::imageToPng(img, full_path);
+                                }
+                                if (shared) {
+                                    plt->clearReadWindow();
+                                }
+                            }
+                        }
+                    });
+                }
+                pool.wait_for_tasks();
 
                 fLabels.close();
 
@@ -411,6 +411,9 @@ void drawImGuiLabelTableDialog(Manager::GwPlot* plot, bool& redraw) {
             std::string filterLower = lowerCopy(trimmedFilter);
             for (int i = 0; i < (int)labels.size(); ++i) {
                 Utils::Label& lbl = labels[i];
+                if (!vt.hasRecord(i)) {
+                    continue;
+                }
                 bool keep = trimmedFilter.empty();
                 if (!keep && useRegionFilter) {
                     keep = (i < (int)vt.multiRegions.size())
@@ -0,0 +1,194 @@
+//
+// Feature name suggestions for the command box
+//
+#include <algorithm>
+#include <cctype>
+#include <utility>
+
+#include "name_completer.h"
+
+
+namespace {
+
+    inline char lower(char c) {
+        return (char)std::tolower((unsigned char)c);
+    }
+
+    // Case-insensitive order, ties broken by the exact bytes so that duplicates are adjacent
+    bool nameLess(std::string_view a, std::string_view b) {
+        const size_t n = std::min(a.size(), b.size());
+        for (size_t i = 0; i < n; ++i) {
+            const char ca = lower(a[i]), cb = lower(b[i]);
+            if (ca != cb) {
+                return ca < cb;
+            }
+        }
+        if (a.size() != b.size()) {
+            return a.size() < b.size();
+        }
+        return a < b;
+    }
+
+    bool startsWithNoCase(std::string_view s, std::string_view prefix, size_t len) {
+        if (s.size() < len) {
+            return false;
+        }
+        for (size_t i = 0; i < len; ++i) {
+            if (lower(s[i]) != lower(prefix[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+}
+
+namespace HGW {
+
+    NameCompleter::NameCompleter(const std::vector<std::shared_ptr<const FeatureNameIndex>> &indexes) {
+        std::vector<std::string_view> names;
+        size_t total = 0;
+        for (const auto &idx : indexes) {
+            if (idx) {
+                total += idx->size();
+            }
+        }
+        names.reserve(total);
+        for (const auto &idx : indexes) {
+            if (!idx) {
+                continue;
+            }
+            for (size_t i = 0; i < idx->size(); ++i) {
+                names.push_back(idx->name(i));
+            }
+        }
+        std::sort(names.begin(), names.end(), nameLess);
+        names.erase(std::unique(names.begin(), names.end()), names.end());
+        size_t bytes = 0;
+        for (auto n : names) {
+            bytes += n.size();
+        }
+        pool.reserve(bytes);
+        offsets.reserve(names.size() + 1);
+        for (auto n : names) {
+            offsets.push_back(pool.size());
+            pool.append(n);
+        }
+        offsets.push_back(pool.size());
+    }
+
+    std::string_view NameCompleter::name(size_t i) const {
+        return {pool.data() + offsets[i], (size_t)(offsets[i + 1] - offsets[i])};
+    }
+
+    size_t NameCompleter::skipPrefix(size_t from, std::string_view prefix, size_t len) const {
+        size_t lo = from, hi = size();
+        while (lo < hi) {
+            const size_t mid = lo + (hi - lo) / 2;
+            if (startsWithNoCase(name(mid), prefix, len)) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        return lo;
+    }
+
+    void NameCompleter::searchNear(std::string_view query, int dist, size_t skipFrom, size_t skipTo, size_t maxResults,
+                                   std::vector<size_t> &found) const {
+        const size_t m = query.size();
+        std::string q(query);
+        for (auto &c : q) {
+            c = lower(c);
+        }
+        // rows[d] holds the edit distances, counting a swap of neighbours as one edit, between the first
+        // d chars of the current name and every prefix of the query. Rows up to walked.size() are
+        // valid for the chars in walked
+        std::vector<std::vector<int>> rows(1, std::vector<int>(m + 1));
+        for (size_t j = 0; j <= m; ++j) {
+            rows[0][j] = (int)j;
+        }
+        std::string walked;
+        const size_t n = size();
+        size_t i = 0;
+        const size_t limit = found.size() + maxResults;
+        while (i < n && found.size() < limit) {
+            const std::string_view nm = name(i);
+            size_t d = 0;
+            while (d < walked.size() && d < nm.size() && walked[d] == lower(nm[d])) {
+                ++d;
+            }
+            walked.resize(d);
+            bool pruned = false;
+            for (; d < nm.size(); ++d) {
+                const char c = lower(nm[d]);
+                if (rows.size() < d + 2) {
+                    rows.emplace_back(m + 1);
+                }
+                const std::vector<int> &prev = rows[d];
+                std::vector<int> &row = rows[d + 1];
+                row[0] = (int)d + 1;
+                int rowMin = row[0];
+                for (size_t j = 1; j <= m; ++j) {
+                    row[j] = std::min({prev[j] + 1, row[j - 1] + 1, prev[j - 1] + ((q[j - 1] == c) ? 0 : 1)});
+                    if (d > 0 && j > 1 && c == q[j - 2] && walked[d - 1] == q[j - 1]) {  // swapped neighbours
+                        row[j] = std::min(row[j], rows[d - 1][j - 2] + 1);
+                    }
+                    rowMin = std::min(rowMin, row[j]);
+                }
+                walked.push_back(c);
+                if (rowMin > dist) {  // no name under this prefix can come close enough
+                    i = skipPrefix(i, nm, d + 1);
+                    pruned = true;
+                    break;
+                }
+            }
+            if (pruned) {
+                continue;
+            }
+            if (rows[nm.size()][m] == dist && (i < skipFrom || i >= skipTo)) {
+                found.push_back(i);
+            }
+            ++i;
+        }
+    }
+
+    std::vector<std::string> NameCompleter::complete(std::string_view typed, size_t maxResults) const {
+        std::vector<std::string> out;
+        if (typed.empty() || size() == 0 || maxResults == 0) {
+            return out;
+        }
+        size_t lo = 0, hi = size();
+        while (lo < hi) {
+            const size_t mid = lo + (hi - lo) / 2;
+            if (nameLess(name(mid), typed)) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        // Names equal to typed ignoring case can sort just before it
+        while (lo > 0 && startsWithNoCase(name(lo - 1), typed, typed.size())) {
+            --lo;
+        }
+        size_t i = lo;
+        for (; i < size() && out.size() < maxResults && startsWithNoCase(name(i), typed, typed.size()); ++i) {
+            out.emplace_back(name(i));
+        }
+        if (out.size() >= maxResults || typed.size() < 3) {
+            return out;
+        }
+        // Too few names start with typed, so offer near misses such as a mistyped gene name. Each pass
+        // finds names at one distance, so stopping a pass early never drops a closer name than it keeps
+        const int maxDist = (typed.size() <= 5) ? 1 : 2;
+        std::vector<size_t> found;
+        for (int dist = 1; dist <= maxDist && out.size() + found.size() < maxResults; ++dist) {
+            searchNear(typed, dist, lo, i, maxResults - out.size() - found.size(), found);
+        }
+        for (size_t f : found) {
+            out.emplace_back(name(f));
+        }
+        return out;
+    }
+
+}
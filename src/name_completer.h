@@ -0,0 +1,50 @@
+//
+// Feature name suggestions for the command box
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "track_cache.h"
+
+
+namespace HGW {
+
+    /*
+     * The names of every loaded track, deduplicated and sorted case-insensitively in one string
+     * pool. Names that share a prefix are adjacent, so the sorted array acts as an implicit trie:
+     * a prefix query is a binary search, and the edit distance search walks the names in order,
+     * reusing the distance rows of the prefix shared with the previous name and skipping every
+     * name under a prefix that is already too far from the query.
+     */
+    class NameCompleter {
+    public:
+        NameCompleter() = default;
+        explicit NameCompleter(const std::vector<std::shared_ptr<const FeatureNameIndex>> &indexes);
+
+        // Names starting with typed first, in sorted order, then names within a small edit
+        // distance of it, closest first. Case is ignored
+        std::vector<std::string> complete(std::string_view typed, size_t maxResults) const;
+
+        size_t size() const { return (offsets.empty()) ? 0 : offsets.size() - 1; }
+
+    private:
+        std::string pool;
+        std::vector<uint64_t> offsets;  // start of each name in pool, then the end of the last
+
+        std::string_view name(size_t i) const;
+        // Index of the first name at or after from that does not start with the first len chars of prefix
+        size_t skipPrefix(size_t from, std::string_view prefix, size_t len) const;
+        // Appends, in sorted order, up to maxResults names exactly dist edits from query, skipping names
+        // in [skipFrom, skipTo)
+        void searchNear(std::string_view query, int dist, size_t skipFrom, size_t skipTo, size_t maxResults,
+                        std::vector<size_t> &found) const;
+    };
+
+}
@@ -920,7 +920,7 @@ namespace Commands {
                         p->fetchRefSeq(p->regions[index]);
                     }
                 }
-            } else {  // search all tracks for matching name, slow but ok for small tracks
+            } else {  // search the name index of every track
                 if (!p->tracks.empty()) {
                     bool res = HGW::searchTracks(p->tracks, parts[1], rgn);
                     if (res) {
@@ -993,9 +993,9 @@ namespace Commands {
         if (p->mode == Manager::Show::TILED) {
             p->regions.clear();
             if (p->currentVarTrack->blockStart < (int)p->currentVarTrack->multiRegions.size()) {
-                assert (!p->currentVarTrack->multiRegions[p->currentVarTrack->blockStart].empty());
-                if (!p->currentVarTrack->multiRegions[p->currentVarTrack->blockStart][0].chrom.empty()) {
-                    p->regions = p->currentVarTrack->multiRegions[p->currentVarTrack->blockStart];
+                const auto &tileRegions = p->currentVarTrack->multiRegions[p->currentVarTrack->blockStart];
+                if (!tileRegions.empty() && !tileRegions[0].chrom.empty()) {
+                    p->regions = tileRegions;
                     p->fetchRefSeqs();
                 }
             }
@@ -1641,7 +1641,7 @@ namespace Commands {
                 p->fetchRefSeq(p->regions[p->regionSelection]);
                 p->regions[p->regionSelection].chromLen = faidx_seq_len(p->fai, p->regions[p->regionSelection].chrom.c_str());
             }
-        } else {  // search all tracks for matching name, slow but ok for small tracks
+        } else {  // search the name index of every track
             reason = search_for_feature(p, command, rgn);
         }
         if (reason == Err::NONE && p->frameId >= 0) {
@@ -1803,7 +1803,7 @@ namespace Commands {
         bool added = false;
         for (auto& t : p->tracks) {
             if (t.kind == HGW::FType::ROI) {
-                t.allBlocks[b.chrom].add(b.start, b.end, b);
+                t.addBlock(b);
                 t.allBlocks[b.chrom].index();
                 added = true;
                 break;
@@ -1813,7 +1813,7 @@ namespace Commands {
             p->tracks.emplace_back() = HGW::GwTrack();
             p->tracks.back().kind = HGW::FType::ROI;
             p->tracks.back().add_to_dict = true;
-            p->tracks.back().allBlocks[b.chrom].add(b.start, b.end, b);
+            p->tracks.back().addBlock(b);
             p->tracks.back().allBlocks[b.chrom].index();
             p->tracks.back().faceColour = p->opts.theme.fcRoi;
         }
@@ -205,8 +205,9 @@ namespace Manager {
                 processed = false;
                 imageCacheQueue.clear();
                 if (currentVarTrack->blockStart < (int)currentVarTrack->multiRegions.size()) {
-                    assert (!currentVarTrack->multiRegions[currentVarTrack->blockStart].empty());
-                    if (currentVarTrack->multiRegions[currentVarTrack->blockStart][0].chrom.empty()) {
+                    // records not read yet, e.g. those skipped by a search, have no regions
+                    if (currentVarTrack->multiRegions[currentVarTrack->blockStart].empty() ||
+                        currentVarTrack->multiRegions[currentVarTrack->blockStart][0].chrom.empty()) {
                         return key; // check for "" no chrom set
                     } else {
                         regions = currentVarTrack->multiRegions[currentVarTrack->blockStart];
@@ -338,6 +339,16 @@ namespace Manager {
                 return GLFW_KEY_UNKNOWN;
             }
 
+            if (key == GLFW_KEY_TAB && mode != SETTINGS) {  // complete a feature name
+                const std::vector<std::string> &names = commandNameSuggestions();
+                if (!names.empty()) {
+                    inputText = ((Utils::startsWith(inputText, "goto ")) ? "goto " : "") + names.front();
+                    charIndex = (int)inputText.size();
+                    commandToolTipIndex = -1;
+                    return GLFW_KEY_UNKNOWN;
+                }
+            }
+
             const bool no_command_selected = commandToolTipIndex == -1;
 
             if (no_command_selected) {
@@ -548,7 +559,7 @@ namespace Manager {
                 continue;
             }
             trk.clear();
-            trk.open(trk.path, true);
+            trk.open(trk.path, true, trackOpenPool());
         }
         processed = false;
         redraw = true;
@@ -601,7 +612,7 @@ namespace Manager {
             trk.close();
             trk.clear();
             trk.track_label_parser_rules = opts.track_label_parser_rules;
-            trk.open(path, true);
+            trk.open(path, true, trackOpenPool());
             trk.variant_distance = &opts.variant_distance;
             trk.setPaint((trk.kind == HGW::FType::BIGWIG) ? opts.theme.fcBigWig : opts.theme.fcTrack);
             reloaded = true;
@@ -774,7 +785,7 @@ namespace Manager {
         out << ind;
         term_width -= (int)ind.size();
 
-        if ((int)currentVarTrack->multiRegions.size() <= blockStart) {
+        if ((int)currentVarTrack->multiRegions.size() <= blockStart || currentVarTrack->multiRegions[blockStart].empty()) {
             out << std::flush;
             return;
         }
@@ -790,12 +801,13 @@ namespace Manager {
         out << region_str1;
         term_width -= (int)region_str1.size();
 
-        if ((int)currentVarTrack->multiRegions.size() <= blockStart + (opts.number.x * opts.number.y) - 1) {
+        const int endIdx = blockStart + (opts.number.x * opts.number.y) - 1;
+        if ((int)currentVarTrack->multiRegions.size() <= endIdx || currentVarTrack->multiRegions[endIdx].empty()) {
             out << std::flush;
             return;
         }
 
-        Utils::Region &end_region = currentVarTrack->multiRegions[blockStart + (opts.number.x * opts.number.y) - 1].front();
+        Utils::Region &end_region = currentVarTrack->multiRegions[endIdx].front();
         int end = end_region.end;
         std::string region_str2 = + "-" + std::to_string(end);
         if (term_width <= (int)region_str2.size()) {
@@ -917,7 +929,7 @@ namespace Manager {
                     }
                     if (!already_loaded) {
                         tracks.resize(tracks.size() + 1);
-                        tracks.back().open(trk_item, true);
+                        tracks.back().open(trk_item, true, trackOpenPool());
                     }
                 }
             }
@@ -983,7 +995,7 @@ namespace Manager {
                     }
                     if (!already_loaded) {
                         tracks.resize(tracks.size() + 1);
-                        tracks.back().open(trk_item, true);
+                        tracks.back().open(trk_item, true, trackOpenPool());
                     }
                 }
             }
@@ -1328,7 +1340,7 @@ namespace Manager {
                         mouseOverTileIndex = 0;
                         redraw = true;
                     }
-                    else if (!*currentVarTrack->trackDone) {
+                    else if (!*currentVarTrack->trackDone || currentVarTrack->hasRecord(currentVarTrack->blockStart + bLen)) {
                         currentVarTrack->blockStart += bLen;
                         mouseOverTileIndex = 0;
                         redraw = true;
@@ -1446,7 +1458,7 @@ namespace Manager {
             tracks.push_back(HGW::GwTrack());
             try {
                 tracks.back().track_label_parser_rules = opts.track_label_parser_rules;
-                tracks.back().open(path, true);
+                tracks.back().open(path, true, trackOpenPool());
                 tracks.back().variant_distance = &opts.variant_distance;
                 tracks.back().setPaint((tracks.back().kind == HGW::FType::BIGWIG) ? opts.theme.fcBigWig : opts.theme.fcTrack);
 //                if (tracks.back().kind == HGW::FType::BIGWIG) {
@@ -2349,7 +2361,8 @@ namespace Manager {
 
     void GwPlot::handleMultiRegionSelection(int boxIdx) {
         if (currentVarTrack->blockStart + boxIdx < (int)currentVarTrack->multiRegions.size()) {
-            if (currentVarTrack->multiRegions[currentVarTrack->blockStart + boxIdx][0].chrom.empty()) {
+            if (currentVarTrack->multiRegions[currentVarTrack->blockStart + boxIdx].empty() ||
+                currentVarTrack->multiRegions[currentVarTrack->blockStart + boxIdx][0].chrom.empty()) {
                 resetDragState();
                 return; // check for "" no chrom set
             } else {
@@ -2423,7 +2436,7 @@ namespace Manager {
                     resetDragState();
                     return;
                 }
-            } else if (*currentVarTrack->trackDone) {
+            } else if (*currentVarTrack->trackDone && !currentVarTrack->hasRecord(currentVarTrack->blockStart + nmb)) {
                 resetDragState();
                 return;
             }
@@ -2880,6 +2893,9 @@ namespace Manager {
                     if (i != mouseOverTileIndex) {
                         mouseOverTileIndex = i;
                     }
+                    if (!currentVarTrack->hasRecord(currentVarTrack->blockStart + i)) {
+                        return;
+                    }
                     Utils::Label *label = &currentVarTrack->multiLabels[currentVarTrack->blockStart + i];
                     label->mouseOver = true;
                     Term::printVariantFileInfo(label, mouseOverTileIndex + currentVarTrack->blockStart, out);
@@ -1,6 +1,7 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <chrono>
 #include <cstdlib>
 #include <fcntl.h>
@@ -63,8 +64,6 @@ using namespace std::literals;
 
 namespace Manager {
 
-    std::mutex g_mutex;
-
     // Load a FASTA index, suppressing htslib's stderr chatter for remote URLs.
     static faidx_t* fai_load_quiet(const char* path) {
         bool isRemote = (strncmp(path, "http://", 7) == 0 ||
@@ -124,6 +123,9 @@ namespace Manager {
         drawLocation = true;
         captureText = false;
         drawToBackWindow = false;
+        if (opts.threads > 1) {
+            pool.reset(opts.threads);
+        }
         textFromSettings = false;
         terminalOutput = true;
         monitorScale = 1;
@@ -183,7 +185,7 @@ namespace Manager {
                     tracks.emplace_back() = HGW::GwTrack();
                     tracks.back().genome_tag = opts.genome_tag;
                     tracks.back().track_label_parser_rules = opts.track_label_parser_rules;
-                    tracks.back().open(trk_item, true);
+                    tracks.back().open(trk_item, true, trackOpenPool());
                     tracks.back().variant_distance = &opts.variant_distance;
                     tracks.back().setPaint((tracks.back().kind == HGW::FType::BIGWIG) ? opts.theme.fcBigWig : opts.theme.fcTrack);
                 }
@@ -198,7 +200,7 @@ namespace Manager {
         for (const auto &tp: track_paths) {
             tracks.emplace_back() = HGW::GwTrack();
             tracks.back().track_label_parser_rules = opts.track_label_parser_rules;
-            tracks.back().open(tp, true);
+            tracks.back().open(tp, true, trackOpenPool());
             tracks.back().variant_distance = &opts.variant_distance;
             tracks.back().setPaint((tracks.back().kind == HGW::FType::BIGWIG) ? opts.theme.fcBigWig : opts.theme.fcTrack);
         }
@@ -213,9 +215,6 @@ namespace Manager {
         variantFileSelection = 0;
         commandToolTipIndex = -1;
         mode = Show::SINGLE;
-        if (opts.threads > 1) {
-            pool.reset(opts.threads);
-        }
         triggerClose = false;
         window = nullptr;
 
@@ -225,6 +224,7 @@ namespace Manager {
         if (window != nullptr) {
             glfwDestroyWindow(window);
         }
+        clearReadWindow();
         for (auto &bm: bams) {
             hts_close(bm);
         }
@@ -653,14 +653,22 @@ namespace Manager {
             rgn.chromLen = faidx_seq_len(fai, rgn.chrom.c_str());
         }
         if (rgn.regionLen < opts.snp_threshold || rgn.regionLen < 20000) {
-            rgn.refSeq = faidx_fetch_seq(fai, rgn.chrom.c_str(), rgn.start, rgn.end - 1, &rgn.regionLen);
+            if (inReadWindow(rgn) && !windowRefSeq.empty()) {  // a slice of the sequence of the window
+                rgn.refSeq = windowRefSeq.data() + (rgn.start - readWindow.start);
+                rgn.regionLen = std::max(0, std::min(rgn.end, readWindow.start + (int)windowRefSeq.size()) - rgn.start);
+            } else {
+                rgn.refSeq = faidx_fetch_seq(fai, rgn.chrom.c_str(), rgn.start, rgn.end - 1, &rgn.regionLen);
+            }
             if (rgn.end <= rgn.chromLen) {
                 rgn.refSeqLen = rgn.end - rgn.start;
             } else {
                 rgn.refSeqLen = rgn.chromLen - rgn.start;
             }
+            // drawRef builds its cached colour strip from these codes
+            Utils::nibbleSequence(rgn.refSeq, rgn.regionLen, rgn.refSeq_nibbled);
         } else {
             rgn.refSeqLen = 0;
+            rgn.refSeq_nibbled.clear();
         }
     }
 
@@ -746,6 +754,10 @@ namespace Manager {
             }
             int i = 0;
             for (auto &l: vf.multiLabels) {
+                if (!vf.hasRecord(i)) {  // not read yet, so still unlabelled
+                    i += 1;
+                    continue;
+                }
                 if (vf.type == HGW::TrackType::IMAGES) {
                     std::filesystem::path fsp(vf.image_glob[i]);
 #if defined(_WIN32) || defined(_WIN64)
@@ -764,6 +776,8 @@ namespace Manager {
         f.close();
     }
 
+    static std::atomic<uint64_t> ideogramLoads{0};
+
     void GwPlot::addIdeogram(std::string path) {
         if (path == "hg19" || path == "hg38" || path == "grch38" || path == "grch37" || path == "t2t" ||
             path == "mm39" || path == "ce11" || path == "danrer11") {
@@ -775,12 +789,14 @@ namespace Manager {
         }
         ideogram_path = path;
         Themes::readIdeogramFile(path, ideogram, opts.theme);
+        ideogramGeneration = ++ideogramLoads;
     }
 
     bool GwPlot::loadIdeogramTag() {
         const unsigned char* ptr;
         size_t size = 0;
         bool good = false;
+        ideogramGeneration = ++ideogramLoads;
         if (opts.genome_tag == "hg19") {
             Ideo::get_hg19_cytoBand_bed(ptr, size);
             Themes::readIdeogramData(ptr, size, ideogram, opts.theme, false);
@@ -948,7 +964,7 @@ namespace Manager {
             } else if (Utils::startsWith(item.first, "track")) {
                 tracks.emplace_back(HGW::GwTrack());
                 tracks.back().track_label_parser_rules = opts.track_label_parser_rules;
-                tracks.back().open(item.second, true);
+                tracks.back().open(item.second, true, trackOpenPool());
                 tracks.back().setPaint((tracks.back().kind == HGW::FType::BIGWIG) ? opts.theme.fcBigWig : opts.theme.fcTrack);
                 tracks.back().variant_distance = &opts.variant_distance;
             } else if (Utils::startsWith(item.first, "region")) {
@@ -972,8 +988,9 @@ namespace Manager {
             } else if (Utils::startsWith(item.first, "mode")) {
                 mode = (item.second == "tiled") ? Show::TILED : Show::SINGLE;
             } else if (Utils::startsWith(item.first, "var") && count < variantTracks.size()) {
-                variantTracks[count].iterateToIndex(std::stoi(item.second) + (opts.number.x * opts.number.y));
-                variantTracks[count].blockStart = std::stoi(item.second);
+                int first = std::stoi(item.second);
+                variantTracks[count].loadRange(first, first + (opts.number.x * opts.number.y));
+                variantTracks[count].blockStart = first;
                 count += 1;
             }
         }
@@ -1237,6 +1254,12 @@ namespace Manager {
                 autoSaveTimer = std::chrono::high_resolution_clock::now();
             }
 
+            if (updateTrackLoaders()) {
+                redraw = true;
+            }
+            if (updateNameCompleter() && captureText) {
+                redraw = true;
+            }
             if (redraw) {
                 if (mode == Show::SINGLE) {
                     drawScreen();
@@ -1273,9 +1296,6 @@ namespace Manager {
             while (imageCacheQueue.size() > 100) {
                 imageCacheQueue.pop_front();
             }
-            if (imageCache.size() > 1000) {
-                imageCache.clear();
-            }
 
         }
         saveLabels();
@@ -1291,6 +1311,120 @@ namespace Manager {
         return 1;
     }
 
+    // In the interactive window, indexed tracks are read on trackLoadPool instead of inside drawTracks.
+    // Returns true if a track received data since the last frame and the screen should be redrawn
+    bool GwPlot::updateTrackLoaders() {
+#if !defined(__EMSCRIPTEN__)
+        bool arrived = false;
+        for (auto &trk : tracks) {
+            if (!trk.loader && HGW::TrackLoader::supports(trk.kind)) {
+                if (!trackLoadPool) {
+                    trackLoadPool = std::make_unique<BS::thread_pool>(2);
+                }
+                trk.loader = std::make_shared<HGW::TrackLoader>(*trackLoadPool, []() { glfwPostEmptyEvent(); });
+            }
+            arrived |= trk.adoptLoaded();
+        }
+        return arrived;
+#else
+        return false;
+#endif
+    }
+
+    // Indexed tracks and tracks with a sidecar are read on trackLoadPool. Names held only in memory
+    // are collected here first, as the records of a track move when tracks are added or removed.
+    // Returns true when a new completer was adopted
+    bool GwPlot::updateNameCompleter() {
+#if !defined(__EMSCRIPTEN__)
+        bool adopted = false;
+        if (nameIndexJob.valid()) {
+            if (nameIndexJob.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                return false;
+            }
+            NameIndexJob done = nameIndexJob.get();
+            for (size_t i = 0; i < done.paths.size() && i < tracks.size(); ++i) {
+                if (tracks[i].path == done.paths[i] && !tracks[i].nameIndex) {
+                    tracks[i].nameIndex = done.indexes[i];
+                }
+            }
+            nameCompleter = done.completer;
+            nameSuggestionsFor.clear();
+            adopted = true;
+        }
+        std::string key;
+        for (const auto &trk : tracks) {
+            key += trk.path;
+            key += '\n';
+        }
+        if (key == nameIndexTracks) {
+            return adopted;
+        }
+        nameIndexTracks = key;
+        if (tracks.empty()) {
+            nameCompleter.reset();
+            nameSuggestionsFor.clear();
+            return true;
+        }
+        struct Input {
+            std::string path, labelRules;
+            HGW::FType kind;
+            std::shared_ptr<HGW::MappedTrackFile> mapped;
+            std::shared_ptr<const HGW::FeatureNameIndex> index;
+        };
+        std::vector<Input> inputs;
+        for (auto &trk : tracks) {
+            if (!trk.nameIndex && HGW::isNonIndexed(trk.kind) && !trk.mappedBlocks) {
+                trk.buildNameIndex();
+            }
+            inputs.push_back({trk.path, trk.track_label_parser_rules, trk.kind, trk.mappedBlocks, trk.nameIndex});
+        }
+        if (!trackLoadPool) {
+            trackLoadPool = std::make_unique<BS::thread_pool>(2);
+        }
+        nameIndexJob = trackLoadPool->submit([inputs]() {
+            NameIndexJob job;
+            for (const auto &in : inputs) {
+                job.paths.push_back(in.path);
+                job.indexes.push_back((in.index) ? in.index : HGW::GwTrack::readNameIndex(in.path, in.kind, in.labelRules, in.mapped));
+            }
+            job.completer = std::make_shared<HGW::NameCompleter>(job.indexes);
+            glfwPostEmptyEvent();
+            return job;
+        });
+        return adopted;
+#else
+        return false;
+#endif
+    }
+
+    // Names are offered for text that cannot be a command, or for the argument of goto
+    const std::vector<std::string> &GwPlot::commandNameSuggestions() {
+        constexpr size_t maxSuggestions = 8;
+        if (inputText == nameSuggestionsFor) {
+            return nameSuggestions;
+        }
+        nameSuggestionsFor = inputText;
+        nameSuggestions.clear();
+        if (!nameCompleter) {
+            return nameSuggestions;
+        }
+        std::string_view typed = inputText;
+        if (Utils::startsWith(inputText, "goto ")) {
+            typed.remove_prefix(5);
+        } else {
+            for (const auto &cmd : Menu::commandToolTip) {
+                if (Utils::startsWith(cmd, inputText) || Utils::startsWith(inputText, std::string(cmd) + " ")) {
+                    return nameSuggestions;
+                }
+            }
+        }
+        if (typed.size() < 2 || typed.find(' ') != std::string_view::npos) {
+            return nameSuggestions;
+        }
+        nameSuggestions = nameCompleter->complete(typed, maxSuggestions);
+        return nameSuggestions;
+    }
+
 #ifdef __EMSCRIPTEN__
     int GwPlot::startUIwasm(GrDirectContext* sContext, SkSurface* sSurface, GLFWwindow* wind,
                             int delay,
@@ -1405,7 +1539,6 @@ namespace Manager {
             glfwSwapBuffers(s.wind);
 
             while (p->imageCacheQueue.size() > 100) { p->imageCacheQueue.pop_front(); }
-            if (p->imageCache.size() > 1000)         { p->imageCache.clear(); }
         };
 
         // 0 fps → driven by requestAnimationFrame.
@@ -1474,9 +1607,15 @@ namespace Manager {
 
                 if (reg->end - reg->start < opts.low_memory || opts.link_op != 0) {
 
-                    HGW::collectReadsAndCoverage(collections[idx], b, hdr_ptr, index, opts.threads, reg,
-                                                 (bool) opts.max_coverage, filters, pool, parse_mods_threshold,
-                                                 opts.soft_clip_threshold > 0);
+                    if (inReadWindow(*reg)) {
+                        loadWindowReads(parse_mods_threshold, opts.soft_clip_threshold > 0);
+                        HGW::collectWindowReadsAndCoverage(collections[idx], windowCollections[i], hdr_ptr, reg,
+                                                           (bool) opts.max_coverage, filters);
+                    } else {
+                        HGW::collectReadsAndCoverage(collections[idx], b, hdr_ptr, index, opts.threads, reg,
+                                                     (bool) opts.max_coverage, filters, pool, parse_mods_threshold,
+                                                     opts.soft_clip_threshold > 0);
+                    }
 
                     int sort_state = Segs::getSortCodes(collections[idx].readQueue, opts.threads, pool, reg);
                     int maxY = Segs::findY(collections[idx], collections[idx].readQueue, opts.link_op, opts,
@@ -1501,6 +1640,66 @@ namespace Manager {
         }
     }
 
+    // Sets chrom:start-end as the window of a group of sites close to each other, which are then drawn without
+    // fetching the reference, the reads and indexed tracks again for each. The reference and track windows are
+    // fetched here, the reads by processBam
+    void GwPlot::setReadWindow(const std::string &chrom, int start, int end) {
+        clearReadWindow();
+        readWindow.chrom = chrom;
+        readWindow.start = start;
+        readWindow.end = end;
+        if (fai != nullptr) {
+            int len = 0;
+            char *seq = faidx_fetch_seq(fai, chrom.c_str(), start, end - 1, &len);
+            if (seq != nullptr) {
+                windowRefSeq.assign(seq, (len > 0) ? len : 0);
+                free(seq);
+            }
+        }
+        for (auto &trk: tracks) {  // leaves a cached window holding the group, bigWig windows depend on the zoom
+            if (!HGW::isNonIndexed(trk.kind) && trk.kind != HGW::BIGWIG) {
+                trk.fetch(&readWindow);
+            }
+        }
+    }
+
+    void GwPlot::clearReadWindow() {
+        for (auto &wc: windowCollections) {
+            wc.clear();
+        }
+        windowCollections.clear();
+        windowRefSeq.clear();
+        readWindow = Utils::Region();
+    }
+
+    bool GwPlot::inReadWindow(const Utils::Region &rgn) const {
+        return !readWindow.chrom.empty() && rgn.chrom == readWindow.chrom &&
+               rgn.start >= readWindow.start && rgn.end <= readWindow.end;
+    }
+
+    // Reads the window from each bam, or reads it again if the reads were parsed with other options, e.g.
+    // after a mods or soft-clip command
+    void GwPlot::loadWindowReads(const int parse_mods_threshold, const bool add_soft_clip_space) {
+        if (windowCollections.size() == bams.size() && windowParseMods == parse_mods_threshold &&
+            windowSoftClipSpace == add_soft_clip_space) {
+            return;
+        }
+        for (auto &wc: windowCollections) {
+            wc.clear();
+        }
+        std::vector<Parse::Parser> noFilters;  // applied to the reads of each region, which may differ by region
+        windowCollections.resize(bams.size());
+        for (int i = 0; i < (int) bams.size(); ++i) {
+            Segs::ReadCollection &wc = windowCollections[i];
+            wc.bamIdx = i;
+            wc.region = &readWindow;
+            HGW::collectReadsAndCoverage(wc, bams[i], headers[i], indexes[i], opts.threads, &readWindow,
+                                         false, noFilters, pool, parse_mods_threshold, add_soft_clip_space);
+        }
+        windowParseMods = parse_mods_threshold;
+        windowSoftClipSpace = add_soft_clip_space;
+    }
+
     void GwPlot::resetCollectionRegionPtrs() {
         for (auto& cl: collections) {
             cl.region = &regions[cl.regionIdx];
@@ -1898,6 +2097,7 @@ namespace Manager {
         ctx.topMenuSpace = topMenuSpace;
         ctx.overlayHeight = fonts.overlayHeight;
         ctx.drawLocation = drawLocation;
+        ctx.ideogramGeneration = ideogramGeneration;
         ctx.selectedIntronChrom = selectedIntronChrom;
         ctx.selectedIntronStart = selectedIntronStart;
         ctx.selectedIntronEnd = selectedIntronEnd;
@@ -2141,6 +2341,23 @@ namespace Manager {
                     }
                     yy -= fonts.overlayHeight + padT;
                 }
+
+                const std::vector<std::string> &names = commandNameSuggestions();
+                if (!names.empty()) {
+                    float step = fonts.overlayHeight + padT;
+                    float top = yy - ((float)names.size() * step);
+                    float names_w = 0;
+                    for (const auto &nm : names) {
+                        names_w = std::fmax(names_w, fonts.overlay.measureText(nm.c_str(), nm.size(), SkTextEncoding::kUTF8));
+                    }
+                    rect.setXYWH(0, top, x + (fonts.overlayWidth * 4) + names_w, ((float)names.size() * step) + padT + padT);
+                    canvas->drawRoundRect(rect, 10, 10, bg);
+                    for (const auto &nm : names) {
+                        sk_sp<SkTextBlob> blob = SkTextBlob::MakeFromString(nm.c_str(), fonts.overlay);
+                        canvas->drawTextBlob(blob, x + (fonts.overlayWidth * 3), yy, opts.theme.tcDel);
+                        yy -= step;
+                    }
+                }
             }
         }
 
@@ -2214,68 +2431,153 @@ namespace Manager {
         int bStart = currentVarTrack->blockStart;
         int bLen = (int)opts.number.x * (int)opts.number.y;
         int endIdx = bStart + bLen;
-        currentVarTrack->iterateToIndex(endIdx);
+        currentVarTrack->loadRange(bStart, endIdx);
+        imageCache.keepAtLeast(3 * bLen);  // the page shown and the pages either side
+        if (tilePrerenderer) {
+            tilePrerenderer->collect(imageCache, imageCache.generation());
+        }
+        const int tileWidth = (bboxes.empty()) ? fb_width : (int)bboxes[0].width;
+        const int tileHeight = (bboxes.empty()) ? fb_height : (int)bboxes[0].height;
         for (int i=bStart; i<endIdx; ++i) {
-            bool c = imageCache.find(i) != imageCache.end();
-            if (!c && i < (int)currentVarTrack->multiRegions.size() && !bams.empty()) {
+            bool c = imageCache.contains(i);
+            if (!c && i < (int)currentVarTrack->multiRegions.size() && !currentVarTrack->multiRegions[i].empty() && !bams.empty()) {
                 this->regions = currentVarTrack->multiRegions[i];
-//                runDrawOnCanvas(canvas);
-                runDrawOnCanvas(rasterCanvas);
-//                sContext->flush();
-//                sk_sp<SkImage> img(sSurface->makeImageSnapshot());
-//                imageCache[i] = img;
-                imageCache[i] = rasterSurfacePtr[0]->makeImageSnapshot();
+                imageCache.insert(i, drawTileImage(tileWidth, tileHeight));
             }
         }
+        prerenderTiles();
     }
 
-    void GwPlot::tileLoadingThread() {
-        currentVarTrack = &variantTracks[variantFileSelection];
-        int bStart = currentVarTrack->blockStart;
-        int bLen = (int)opts.number.x * (int)opts.number.y;
-        int endIdx = bStart + bLen;
-        int n_images = (int)currentVarTrack->image_glob.size();
-        pool.parallelize_loop(bStart, endIdx,
-                              [&](const int a, const int b) {
-                                  for (int i=a; i<b; ++i) {
-                                      g_mutex.lock();
-                                      bool c = imageCache.find(i) != imageCache.end();
-                                      g_mutex.unlock();
-                                      if (!c && i < n_images) {
-                                          sk_sp<SkData> data(nullptr);
-                                          g_mutex.lock();
+    // Draws the current regions at the size of one tile. The layout is that of the whole canvas shrunk to
+    // the tile, so text, gaps and track heights are scaled down with it rather than the finished image
+    sk_sp<SkImage> GwPlot::drawTileImage(int width, int height) {
+        const int canvasWidth = fb_width;
+        const int canvasHeight = fb_height;
+        const float canvasScale = monitorScale;
+        width = std::max(width, 1);
+        height = std::max(height, 1);
+        if (!tileSurface || tileSurface->width() != width || tileSurface->height() != height) {
+            // a surface made from the canvas surface is on the same backend, the GPU if there is one
+            tileSurface = rasterSurfacePtr[0]->makeSurface(SkImageInfo::MakeN32Premul(width, height));
+        }
+        // A tile is kept in imageCache and not drawn again when track data arrives, so tracks are read here
+        // rather than drawn as loading
+        std::vector<std::shared_ptr<HGW::TrackLoader>> loaders(tracks.size());
+        for (size_t k = 0; k < tracks.size(); ++k) {
+            loaders[k] = std::move(tracks[k].loader);
+        }
+        monitorScale = canvasScale * std::fmin((float)width / (float)canvasWidth, (float)height / (float)canvasHeight);
+        setImageSize(width, height);
+        runDrawOnCanvas(tileSurface->getCanvas());
+        monitorScale = canvasScale;
+        setImageSize(canvasWidth, canvasHeight);
+        for (size_t k = 0; k < tracks.size(); ++k) {
+            tracks[k].loader = std::move(loaders[k]);
+        }
+        return tileSurface->makeImageSnapshot();
+    }
 
+    // image_glob holds wide strings on Windows
+    static std::string imageFileName(const std::filesystem::path &path) {
 #if defined(_WIN32)
-                                          const wchar_t *outp = currentVarTrack->image_glob[i].c_str();
-                                          std::wstring pw(outp);
-                                          std::string outp_str(pw.begin(), pw.end());
-                                          const char *fname = outp_str.c_str();
+        std::wstring pw(path.c_str());
+        return std::string(pw.begin(), pw.end());
 #else
-                                          const char *fname = currentVarTrack->image_glob[i].c_str();
+        return path.string();
 #endif
-                                          g_mutex.unlock();
-                                          data = SkData::MakeFromFileName(fname);
-                                          if (!data)
-                                              throw std::runtime_error("Error: file not found");
-#if !defined(OLD_SKIA) || OLD_SKIA == 0
-                                          sk_sp<SkImage> image = SkImages::DeferredFromEncodedData(data);
-#else
-                                          sk_sp<SkImage> image = SkImage::MakeFromEncoded(data);
+    }
+
+    // Queues the tiles of the previous and next pages that are not drawn yet, the next page first
+    void GwPlot::prerenderTiles() {
+#if !defined(__EMSCRIPTEN__)
+        int bStart = currentVarTrack->blockStart;
+        int bLen = (int)opts.number.x * (int)opts.number.y;
+        int prevStart = std::max(0, bStart - bLen);
+        std::vector<std::pair<int, std::vector<Utils::Region>>> tiles;
+        std::vector<std::pair<int, std::string>> images;
+        if (!currentVarTrack->image_glob.empty()) {
+            int n_images = (int)currentVarTrack->image_glob.size();
+            auto addPage = [&](int first, int last) {
+                for (int i = first; i < last && i < n_images; ++i) {
+                    if (!imageCache.contains(i)) {
+                        images.emplace_back(i, imageFileName(currentVarTrack->image_glob[i]));
+                    }
+                }
+            };
+            addPage(bStart + bLen, bStart + 2 * bLen);
+            addPage(prevStart, bStart);
+        } else {
+            if (bams.empty() || currentVarTrack->type == HGW::TrackType::IMAGES) {
+                return;
+            }
+            currentVarTrack->loadRange(prevStart, bStart);
+            currentVarTrack->loadRange(bStart + bLen, bStart + 2 * bLen);
+            auto addPage = [&](int first, int last) {
+                for (int i = first; i < last && i < (int)currentVarTrack->multiRegions.size(); ++i) {
+                    if (!currentVarTrack->multiRegions[i].empty() && !imageCache.contains(i)) {
+                        tiles.emplace_back(i, currentVarTrack->multiRegions[i]);
+                    }
+                }
+            };
+            addPage(bStart + bLen, bStart + 2 * bLen);
+            addPage(prevStart, bStart);
+        }
+        if (tiles.empty() && images.empty()) {
+            return;
+        }
+        if (!tileSource || tileSource->generation != imageCache.generation()) {
+            tileSource = TileSource::from(*this, imageCache.generation());
+        }
+        if (!tilePrerenderer) {
+            tilePrerenderer = std::make_unique<TilePrerenderer>(std::clamp(opts.threads, 1, 4));
+        }
+        if (!images.empty()) {
+            tilePrerenderer->requestImages(tileSource, std::move(images));
+        } else {
+            tilePrerenderer->request(tileSource, std::move(tiles));
+        }
 #endif
-                                          if (!image)
-                                              throw std::runtime_error("Failed to decode an image");
-                                          // if image is not explicitly decoded, it might be lazily decoded during drawing
-                                          sk_sp<SkImage> image_decoded = image->makeRasterImage( SkImage::kAllow_CachingHint);
-                                          g_mutex.lock();
-                                          imageCache[i] = image_decoded;
-                                          g_mutex.unlock();
+    }
+
+    // Decodes the images of the page shown that are not cached, each at about the size of its tile. The cache
+    // is only touched on this thread, the pool fills a slot per image
+    void GwPlot::tileLoadingThread() {
+        currentVarTrack = &variantTracks[variantFileSelection];
+        int bStart = currentVarTrack->blockStart;
+        int bLen = (int)opts.number.x * (int)opts.number.y;
+        int n_images = (int)currentVarTrack->image_glob.size();
+        int endIdx = std::min(bStart + bLen, n_images);
+        const int tileWidth = (bboxes.empty()) ? fb_width : (int)bboxes[0].width;
+        const int tileHeight = (bboxes.empty()) ? fb_height : (int)bboxes[0].height;
+        imageCache.keepAtLeast(3 * bLen);
+        if (tilePrerenderer) {
+            tilePrerenderer->collect(imageCache, imageCache.generation());
+        }
+        std::vector<int> missing;
+        std::vector<std::string> fileNames;
+        for (int i=bStart; i<endIdx; ++i) {
+            if (!imageCache.contains(i)) {
+                missing.push_back(i);
+                fileNames.push_back(imageFileName(currentVarTrack->image_glob[i]));
+            }
+        }
+        std::vector<sk_sp<SkImage>> decoded(missing.size());
+        if (!missing.empty()) {
+            pool.parallelize_loop(0, (int)missing.size(),
+                                  [&](const int a, const int b) {
+                                      for (int j=a; j<b; ++j) {
+                                          decoded[j] = decodeImageTile(fileNames[j], tileWidth, tileHeight);
                                       }
-                                  }
-                              }).wait();
+                                  }).wait();
+        }
+        for (size_t j=0; j<missing.size(); ++j) {
+            imageCache.insert(missing[j], std::move(decoded[j]));  // a file that could not be decoded is left blank
+        }
 
         if (currentVarTrack->type == HGW::TrackType::IMAGES) {
             currentVarTrack->appendImageLabels(bStart, bLen);
         }
+        prerenderTiles();
     }
 
     void GwPlot::drawTiles() {
@@ -2312,9 +2614,10 @@ namespace Manager {
         int i = bStart;
         for (auto &b : bboxes) {
             SkRect rect;
-            if (imageCache.find(i) != imageCache.end()) {
-                int w = imageCache[i]->width();
-                int h = imageCache[i]->height();
+            sk_sp<SkImage> img = imageCache.get(i);
+            if (img) {
+                int w = img->width();
+                int h = img->height();
                 float ratio = (float)w / (float)h;
                 float box_ratio = (float)b.width / (float)b.height;
                 if (box_ratio > ratio) {
@@ -2328,7 +2631,7 @@ namespace Manager {
                     float newHeight = newWidth / ratio;
                     rect.setXYWH(b.xStart, b.yStart, newWidth, newHeight);
                 }
-                rasterCanvas->drawImageRect(imageCache[i], rect, sampOpts);
+                rasterCanvas->drawImageRect(img, rect, sampOpts);
                 if (currentVarTrack->multiLabels.empty()) {
                     ++i; continue;
                 }
@@ -33,10 +33,12 @@ struct ImFont;  // Forward declaration for Dear ImGui font handle
 #include "glfw_keys.h"
 #include "hts_funcs.h"
 #include "menu.h"
+#include "name_completer.h"
 #include "parser.h"
 #include "utils.h"
 #include "segments.h"
 #include "themes.h"
+#include "tile_renderer.h"
 #include "export_definitions.h"
 
 #define SK_GL
@@ -153,9 +155,19 @@ namespace Manager {
 
         std::vector<Segs::ReadCollection> collections;  // stores alignments
 
+        // A window around a group of nearby sites, see setReadWindow. Regions inside it take their reference
+        // from windowRefSeq, and processBam copies their reads from windowCollections, one per bam. The reads
+        // are only read when first needed, so that they are parsed with the options in use at that point
+        Utils::Region readWindow;
+        std::string windowRefSeq;
+        std::vector<Segs::ReadCollection> windowCollections;
+        int windowParseMods{0};
+        bool windowSoftClipSpace{false};
+
         std::vector<HGW::GwVariantTrack> variantTracks; // make image tiles from these
 
         std::unordered_map<std::string, std::vector<Ideo::Band>> ideogram;
+        uint64_t ideogramGeneration{0};  // unique to each load of ideogram, so drawn strips are not reused across loads
 
         std::vector< std::string > commandHistory, commandsApplied;
 
@@ -164,7 +176,7 @@ namespace Manager {
 
         std::vector<Parse::Parser> filters;
 
-        std::unordered_map< int, sk_sp<SkImage>> imageCache;  // Cace of tiled images
+        TileCache imageCache;  // Cace of tiled images
         std::deque< std::pair<long, sk_sp<SkImage> > > imageCacheQueue;  // cache of previously draw main screen images
 
         // keys are variantFilename and variantId
@@ -287,6 +299,10 @@ namespace Manager {
         void resetCollectionRegionPtrs();
         void setScaling();
         void setVariantSite(std::string &chrom, long start, std::string &chrom2, long stop);
+        void setReadWindow(const std::string &chrom, int start, int end);
+        void clearReadWindow();
+        bool inReadWindow(const Utils::Region &rgn) const;
+        void loadWindowReads(int parse_mods_threshold, bool add_soft_clip_space);
         int startUI(GrDirectContext* sContext, SkSurface *sSurface, int delay, std::vector<std::string> &extra_commands);
 #ifdef __EMSCRIPTEN__
         int startUIwasm(GrDirectContext* sContext, SkSurface* sSurface, GLFWwindow* wind, int delay,
@@ -388,12 +404,40 @@ namespace Manager {
         std::vector<Utils::BoundingBox> bboxes;
 
         BS::thread_pool pool;
+        BS::thread_pool *trackOpenPool() { return (opts.threads > 1) ? &pool : nullptr; }  // chunked parsing in GwTrack::open
+        std::unique_ptr<BS::thread_pool> trackLoadPool;  // background reads of indexed tracks, see HGW::TrackLoader
+
+        bool updateTrackLoaders();
+
+        // Feature names of all tracks for command box suggestions, rebuilt on trackLoadPool when the tracks change
+        struct NameIndexJob {
+            std::vector<std::string> paths;  // track paths the indexes were read for, in order
+            std::vector<std::shared_ptr<const HGW::FeatureNameIndex>> indexes;
+            std::shared_ptr<const HGW::NameCompleter> completer;
+        };
+        std::shared_ptr<const HGW::NameCompleter> nameCompleter;
+        std::future<NameIndexJob> nameIndexJob;
+        std::string nameIndexTracks;
+        std::vector<std::string> nameSuggestions;
+        std::string nameSuggestionsFor;
+
+        bool updateNameCompleter();
+        const std::vector<std::string> &commandNameSuggestions();
 
         void drawOverlay(SkCanvas* canvas);
         void overlayImGui(bool& pending_settings_close);
 
         void tileDrawingThread();
 
+        // Tiles are drawn at the size of their bounding box, on a surface kept for the purpose
+        sk_sp<SkSurface> tileSurface;
+        sk_sp<SkImage> drawTileImage(int width, int height);
+
+        // Tiles of the pages next to the one shown, drawn in the background. tileSource is rebuilt when imageCache is cleared
+        std::unique_ptr<TilePrerenderer> tilePrerenderer;
+        std::shared_ptr<const TileSource> tileSource;
+        void prerenderTiles();
+
         void tileLoadingThread();
 
         void drawTiles();
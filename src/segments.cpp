@@ -846,6 +846,44 @@ namespace Segs {
         self->any_ins.clear();
     }
 
+    void alignLevelOfDetail(const Align &a, AlignLod &lod, const int minGapSize, const int regionLen, const int indelLength) {
+        if (lod.delegate == a.delegate && lod.pos == a.pos && lod.minGap == minGapSize && lod.regionLen == regionLen
+                && lod.indelLength == indelLength) {
+            return;
+        }
+        lod.delegate = a.delegate;
+        lod.pos = a.pos;
+        lod.minGap = minGapSize;
+        lod.regionLen = regionLen;
+        lod.indelLength = indelLength;
+        lod.spans.clear();
+        lod.gaps.clear();
+        const std::vector<ABlock> &blocks = a.blocks;
+        if (blocks.empty()) {
+            return;
+        }
+        ABlock span = blocks.front();
+        for (size_t idx = 1; idx < blocks.size(); ++idx) {
+            const int starti = (int) blocks[idx].start;
+            const int lastEnd = (int) blocks[idx - 1].end;
+            const int size = starti - lastEnd;
+            if (size == 0) {
+                continue;  // insertion, drawn over the top later on
+            }
+            if (size >= minGapSize) {
+                span.end = blocks[idx - 1].end;
+                lod.spans.push_back(span);
+                span = blocks[idx];
+            }
+            // Same thresholds as Drawing::drawDeletionLine, smaller gaps are not drawn
+            if (size > 0 && (size >= indelLength || (float)size * 2000.0f > (float)regionLen)) {
+                lod.gaps.push_back({(uint32_t)lastEnd, (uint32_t)starti});
+            }
+        }
+        span.end = blocks.back().end;
+        lod.spans.push_back(span);
+    }
+
     void init_parallel(std::vector<Align> &aligns, const int n, BS::thread_pool &pool,
         const int parse_mods_threshold, const bool add_clip_space) {
         if (n == 1) {
@@ -984,6 +1022,7 @@ namespace Segs {
             }
         }
         readQueue.clear();
+        lodCache.clear();
     }
 
     void ReadCollection::resetDrawState() {
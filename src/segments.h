@@ -42,6 +42,10 @@ namespace Segs {
         uint32_t pos, length;
     };
 
+    struct EXPORT GapItem {  // deletion or ref-skip between two blocks
+        uint32_t start, end; // on reference
+    };
+
     struct EXPORT ModItem {  // up to 4 modifications
         int index;
         uint8_t n_mods;
@@ -158,6 +162,15 @@ namespace Segs {
     };
 
 
+    // Level-of-detail geometry of one alignment at one zoom level, see alignLevelOfDetail
+    struct AlignLod {
+        const bam1_t *delegate{nullptr};
+        uint32_t pos{0};
+        int minGap{-1}, regionLen{-1}, indelLength{-1};
+        std::vector<ABlock> spans;
+        std::vector<GapItem> gaps;
+    };
+
     struct EXPORT Mismatches {
         uint32_t A, T, C, G;
     };
@@ -176,6 +189,7 @@ namespace Segs {
         std::vector<int> levelsStart, levelsEnd;
         std::vector<Mismatches> mmVector;
         std::vector<Align> readQueue;
+        std::vector<AlignLod> lodCache;  // indexed like readQueue
         map_t linked;
         std::vector<int> sortLevels;
         float xScaling, xOffset, yOffset, yPixels, xPixels;
@@ -199,6 +213,11 @@ namespace Segs {
 
     void EXPORT align_clear(Align *self);
 
+    // Merge blocks separated by gaps narrower than minGapSize (about one pixel) into spans, and keep only the
+    // gaps that are drawn as deletion lines at this zoom level. Long reads with many CIGAR operations then draw a
+    // handful of spans. Results are cached in lod and rebuilt only when the alignment or zoom level changes
+    void EXPORT alignLevelOfDetail(const Align &a, AlignLod &lod, int minGapSize, int regionLen, int indelLength);
+
     void init_parallel(std::vector<Align> &aligns, const int n, BS::thread_pool &pool,
         const int parse_mods_threshold, const bool add_clip_space);
 
@@ -1212,24 +1212,15 @@ namespace Term {
                     out << std::endl;
                     std::vector<std::string> &parts = b.parts;
                     if (isGFF) {
-                        int i = 0; int j = 0;
-                        while (i < (int)parts.size()) {
-                            for (j = i; j < (int)parts.size(); ++j ) {
-                                if (parts[j] == "\n") {
-                                    int start = std::stoi(parts[i + 3]);
-                                    int end = std::stoi(parts[i + 4]);
-                                    if (start <= target && end >= target) {
-                                        bool first = true;
-                                        assert (j >=9);
-                                        for (int k=j-9; k <= j; ++k) {
-                                            if (first) { out << parts[k]; first = false;}
-                                            else { out << "\t" << parts[k]; }
-                                        }
-                                    }
-                                    break;
-                                }
+                        // parts holds the raw line of each child feature
+                        for (auto &line : parts) {
+                            std::string_view cols[5];
+                            int start, end;
+                            if (Utils::splitView(line, '\t', cols, 5, false) == 5 &&
+                                Utils::parseInt(cols[3], start) && Utils::parseInt(cols[4], end) &&
+                                start <= target && end >= target) {
+                                out << line << "\n";
                             }
-                            i = j + 1;
                         }
 
                     } else {
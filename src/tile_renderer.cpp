@@ -0,0 +1,456 @@
+//
+// Rendering of variant tiles away from the interactive plot
+//
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <stdexcept>
+#include <utility>
+
+#include "plot_manager.h"
+#include "tile_renderer.h"
+
+#include "include/codec/SkAndroidCodec.h"
+#include "include/codec/SkCodec.h"
+#include "include/core/SkBitmap.h"
+#include "include/encode/SkPngEncoder.h"
+
+
+namespace {
+
+    size_t pixelBytes(const SkImage *image) {
+        return image->imageInfo().computeMinByteSize();
+    }
+
+    sk_sp<SkData> encodeTile(const sk_sp<SkImage> &image) {
+#if !defined(OLD_SKIA) || OLD_SKIA == 0
+        SkPngEncoder::Options options;
+        options.fZLibLevel = 1;
+        return SkPngEncoder::Encode(nullptr, image.get(), options);
+#else
+        return image->encodeToData();
+#endif
+    }
+
+    sk_sp<SkImage> decodeTile(const sk_sp<SkData> &data) {
+#if !defined(OLD_SKIA) || OLD_SKIA == 0
+        sk_sp<SkImage> image = SkImages::DeferredFromEncodedData(data);
+#else
+        sk_sp<SkImage> image = SkImage::MakeFromEncoded(data);
+#endif
+        return (image) ? image->makeRasterImage(SkImage::kAllow_CachingHint) : nullptr;
+    }
+
+}
+
+namespace Manager {
+
+    TileCache::TileCache(size_t maxBytes, size_t maxEncodedBytes)
+        : maxBytes(maxBytes), maxEncodedBytes(maxEncodedBytes) {}
+
+    sk_sp<SkImage> TileCache::get(int index) {
+        auto it = entries.find(index);
+        if (it == entries.end()) {
+            return nullptr;
+        }
+        Entry &e = it->second;
+        if (e.image) {
+            decodedOrder.splice(decodedOrder.begin(), decodedOrder, e.pos);
+            return e.image;
+        }
+        sk_sp<SkImage> image = decodeTile(e.encoded);
+        encodedBytes -= e.encoded->size();
+        encodedOrder.erase(e.pos);
+        if (!image) {
+            entries.erase(it);
+            return nullptr;
+        }
+        e.encoded.reset();
+        e.image = image;
+        decodedOrder.push_front(index);
+        e.pos = decodedOrder.begin();
+        decodedBytes += pixelBytes(image.get());
+        evict();
+        return image;
+    }
+
+    void TileCache::insert(int index, sk_sp<SkImage> image) {
+        if (!image) {
+            return;
+        }
+        auto it = entries.find(index);
+        if (it != entries.end()) {
+            Entry &old = it->second;
+            if (old.image) {
+                decodedBytes -= pixelBytes(old.image.get());
+                decodedOrder.erase(old.pos);
+            } else {
+                encodedBytes -= old.encoded->size();
+                encodedOrder.erase(old.pos);
+            }
+            entries.erase(it);
+        }
+        decodedBytes += pixelBytes(image.get());
+        decodedOrder.push_front(index);
+        entries[index] = Entry{std::move(image), nullptr, decodedOrder.begin()};
+        evict();
+    }
+
+    void TileCache::keepAtLeast(size_t n) {
+        minImages = std::max<size_t>(n, 1);
+    }
+
+    void TileCache::clear() {
+        entries.clear();
+        decodedOrder.clear();
+        encodedOrder.clear();
+        decodedBytes = encodedBytes = 0;
+        ++gen;
+    }
+
+    void TileCache::evict() {
+        while (decodedBytes > maxBytes && decodedOrder.size() > minImages) {
+            const int index = decodedOrder.back();
+            decodedOrder.pop_back();
+            Entry &e = entries[index];
+            decodedBytes -= pixelBytes(e.image.get());
+            sk_sp<SkData> encoded = (maxEncodedBytes > 0) ? encodeTile(e.image) : nullptr;
+            if (!encoded) {
+                entries.erase(index);
+                continue;
+            }
+            e.image.reset();
+            e.encoded = std::move(encoded);
+            encodedBytes += e.encoded->size();
+            encodedOrder.push_front(index);
+            e.pos = encodedOrder.begin();
+        }
+        while (encodedBytes > maxEncodedBytes && !encodedOrder.empty()) {
+            const int index = encodedOrder.back();
+            encodedOrder.pop_back();
+            encodedBytes -= entries[index].encoded->size();
+            entries.erase(index);
+        }
+    }
+
+    sk_sp<SkImage> decodeImageTile(const std::string &path, int width, int height) {
+        sk_sp<SkData> data = SkData::MakeFromFileName(path.c_str());
+        if (!data) {
+            return nullptr;
+        }
+        std::unique_ptr<SkAndroidCodec> codec = SkAndroidCodec::MakeFromData(data);
+        if (!codec) {
+            return nullptr;
+        }
+        SkISize full = codec->getInfo().dimensions();
+        int sampleSize = 1;
+        while (full.width() / (sampleSize * 2) >= width && full.height() / (sampleSize * 2) >= height) {
+            sampleSize *= 2;
+        }
+        SkISize dims = codec->getSampledDimensions(sampleSize);
+        SkImageInfo info = SkImageInfo::MakeN32Premul(dims.width(), dims.height());
+        SkBitmap bitmap;
+        if (!bitmap.tryAllocPixels(info)) {
+            return nullptr;
+        }
+        SkAndroidCodec::AndroidOptions options;
+        options.fSampleSize = sampleSize;
+        SkCodec::Result result = codec->getAndroidPixels(info, bitmap.getPixels(), bitmap.rowBytes(), &options);
+        if (result != SkCodec::kSuccess && result != SkCodec::kIncompleteInput) {
+            return nullptr;
+        }
+        bitmap.setImmutable();
+#if !defined(OLD_SKIA) || OLD_SKIA == 0
+        return bitmap.asImage();
+#else
+        return SkImage::MakeFromBitmap(bitmap);
+#endif
+    }
+
+    std::shared_ptr<const TileSource> TileSource::from(GwPlot &plot, uint64_t generation) {
+        auto source = std::make_shared<TileSource>();
+        source->generation = generation;
+        source->reference = plot.reference;
+        source->bamPaths = plot.bam_paths;
+        for (const auto &f : plot.filters) {
+            source->filters.push_back(f.filter_str);
+        }
+        source->nRegions = plot.regions.size();
+        for (const auto &trk : plot.tracks) {
+            Track t;
+            if (trk.kind == HGW::FType::ROI || trk.kind == HGW::FType::INTRON) {
+                t.copy = trk;
+                t.copy->loader.reset();
+                if (trk.store) {  // the interactive plot keeps adding to its own store
+                    t.copy->store = std::make_shared<HGW::FeatureStore>(*trk.store);
+                }
+            } else {
+                t.path = trk.path;
+                t.shared = trk.shareBlocks();
+                t.mapped = trk.mappedBlocks;
+            }
+            t.kind = trk.kind;
+            t.name = trk.name;
+            t.faceColour = trk.faceColour;
+            t.shadedFaceColour = trk.shadedFaceColour;
+            t.height_fraction = trk.height_fraction;
+            source->tracks.push_back(std::move(t));
+        }
+        source->ideogram = plot.ideogram;
+        source->ideogramGeneration = plot.ideogramGeneration;
+        source->opts = plot.opts;
+        source->width = plot.fb_width;
+        source->height = plot.fb_height;
+        source->monitorScale = plot.monitorScale;
+        source->showUIOverlay = plot.showUIOverlay;
+        source->drawLocation = plot.drawLocation;
+        if (!plot.bboxes.empty()) {  // laid out as GwPlot::drawTileImage does
+            source->width = std::max((int)plot.bboxes[0].width, 1);
+            source->height = std::max((int)plot.bboxes[0].height, 1);
+            source->monitorScale *= std::fmin((float)source->width / (float)plot.fb_width,
+                                              (float)source->height / (float)plot.fb_height);
+        }
+        return source;
+    }
+
+    bool TileSource::sameFiles(const TileSource &other) const {
+        if (reference != other.reference || bamPaths != other.bamPaths || tracks.size() != other.tracks.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < tracks.size(); ++i) {
+            const Track &a = tracks[i];
+            const Track &b = other.tracks[i];
+            if (a.path != b.path || a.kind != b.kind || a.copy.has_value() != b.copy.has_value() ||
+                a.shared != b.shared || a.mapped != b.mapped) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    TilePrerenderer::TilePrerenderer(int nWorkers)
+        : nWorkers(std::max(1, nWorkers)), state(std::make_shared<State>()), pool(this->nWorkers) {}
+
+    TilePrerenderer::~TilePrerenderer() {
+        {
+            std::lock_guard<std::mutex> lock(state->mtx);
+            state->stopping = true;
+            state->queued.clear();
+        }
+        pool.wait_for_tasks();  // a tile that is being drawn is finished first
+    }
+
+    TilePrerenderer::State::~State() = default;
+
+    void TilePrerenderer::request(std::shared_ptr<const TileSource> source,
+                                  std::vector<std::pair<int, std::vector<Utils::Region>>> tiles) {
+        std::vector<Job> jobs;
+        jobs.reserve(tiles.size());
+        for (auto &t : tiles) {
+            jobs.push_back(Job{t.first, std::move(t.second), ""});
+        }
+        enqueue(std::move(source), std::move(jobs));
+    }
+
+    void TilePrerenderer::requestImages(std::shared_ptr<const TileSource> source,
+                                        std::vector<std::pair<int, std::string>> images) {
+        std::vector<Job> jobs;
+        jobs.reserve(images.size());
+        for (auto &t : images) {
+            jobs.push_back(Job{t.first, {}, std::move(t.second)});
+        }
+        enqueue(std::move(source), std::move(jobs));
+    }
+
+    void TilePrerenderer::enqueue(std::shared_ptr<const TileSource> source, std::vector<Job> jobs) {
+        std::lock_guard<std::mutex> lock(state->mtx);
+        if (state->source != source) {
+            state->source = std::move(source);
+            state->finished.clear();
+        }
+        state->queued.clear();
+        for (auto &job : jobs) {
+            if (std::find(state->active.begin(), state->active.end(), job.index) != state->active.end()) {
+                continue;
+            }
+            if (std::any_of(state->finished.begin(), state->finished.end(),
+                            [&](const auto &f) { return f.first == job.index; })) {
+                continue;
+            }
+            state->queued.push_back(std::move(job));
+        }
+        while (state->running < nWorkers && state->running < (int)state->queued.size()) {
+            state->running += 1;
+            std::shared_ptr<State> st = state;
+            pool.push_task([st]() { run(st); });
+        }
+    }
+
+    size_t TilePrerenderer::collect(TileCache &cache, uint64_t generation) {
+        std::lock_guard<std::mutex> lock(state->mtx);
+        size_t added = 0;
+        if (state->source && state->source->generation == generation) {
+            for (auto &f : state->finished) {
+                if (!cache.contains(f.first)) {
+                    cache.insert(f.first, std::move(f.second));
+                    added += 1;
+                }
+            }
+        }
+        state->finished.clear();
+        return added;
+    }
+
+    // The GwPlot constructor exits the program when the reference or an alignment file cannot be opened,
+    // which a file removed or unmounted while the program runs must not do from a worker
+    static void checkSourceFiles(const TileSource &source) {
+        if (!source.reference.empty()) {
+            faidx_t *fai = fai_load(source.reference.c_str());
+            if (fai == nullptr) {
+                throw std::runtime_error("reference genome could not be opened " + source.reference);
+            }
+            fai_destroy(fai);
+        }
+        for (const auto &fn : source.bamPaths) {
+            htsFile *f = hts_open(fn.c_str(), "r");
+            if (f == nullptr) {
+                throw std::runtime_error("could not open " + fn);
+            }
+            hts_close(f);
+        }
+    }
+
+    std::unique_ptr<GwPlot> TilePrerenderer::makePlot(const TileSource &source) {
+        checkSourceFiles(source);
+        Themes::IniOptions opts = source.opts;
+        opts.threads = 1;
+        opts.ini_path.clear();  // the tracks of the genome tag are already in source.tracks
+        std::string reference = source.reference;
+        std::vector<std::string> bamPaths = source.bamPaths;
+        std::vector<Utils::Region> regions(source.nRegions);
+        std::vector<std::string> noTracks;
+        auto plot = std::make_unique<GwPlot>(reference, bamPaths, opts, regions, noTracks);
+        plot->terminalOutput = false;
+        plot->tracks.reserve(source.tracks.size());
+        for (const auto &t : source.tracks) {
+            if (t.copy) {
+                plot->tracks.push_back(*t.copy);
+            } else {
+                plot->tracks.emplace_back();
+                HGW::GwTrack &trk = plot->tracks.back();
+                trk.genome_tag = plot->opts.genome_tag;
+                trk.track_label_parser_rules = plot->opts.track_label_parser_rules;
+                if (t.shared || t.mapped) {
+                    trk.openLoaded(t.path, t.kind, t.shared, t.mapped);
+                } else {
+                    trk.open(t.path, true);
+                }
+            }
+        }
+        applySource(*plot, source);
+        return plot;
+    }
+
+    // Takes the options and layout of source, for a plot that already has the files of source open
+    void TilePrerenderer::applySource(GwPlot &plot, const TileSource &source) {
+        plot.opts = source.opts;
+        plot.opts.threads = 1;
+        plot.opts.ini_path.clear();
+        plot.fonts.setTypeface(plot.opts.font_str, plot.opts.font_size);
+        plot.monitorScale = source.monitorScale;
+        plot.showUIOverlay = source.showUIOverlay;
+        plot.drawLocation = source.drawLocation;
+        plot.setImageSize(source.width, source.height);
+        plot.tracksLayoutDirty = true;
+        plot.ideogram = source.ideogram;
+        plot.ideogramGeneration = source.ideogramGeneration;
+        plot.regions.assign(source.nRegions, Utils::Region());
+        plot.filters.clear();
+        for (auto f : source.filters) {
+            plot.addFilter(f);
+        }
+        for (size_t i = 0; i < source.tracks.size(); ++i) {
+            const TileSource::Track &t = source.tracks[i];
+            if (t.copy) {  // ROI and INTRON tracks change with the plot
+                plot.tracks[i] = *t.copy;
+            }
+            HGW::GwTrack &trk = plot.tracks[i];
+            trk.variant_distance = &plot.opts.variant_distance;
+            trk.name = t.name;
+            trk.faceColour = t.faceColour;
+            trk.shadedFaceColour = t.shadedFaceColour;
+            trk.height_fraction = t.height_fraction;
+        }
+        if (!plot.rasterSurface || plot.rasterSurface->width() != source.width || plot.rasterSurface->height() != source.height) {
+#if !defined(OLD_SKIA) || OLD_SKIA == 0
+            plot.rasterSurface = SkSurfaces::Raster(SkImageInfo::MakeN32Premul(source.width, source.height));
+#else
+            plot.rasterSurface = SkSurface::MakeRasterN32Premul(source.width, source.height);
+#endif
+            plot.rasterCanvas = plot.rasterSurface->getCanvas();
+            plot.rasterSurfacePtr = &plot.rasterSurface;
+        }
+    }
+
+    void TilePrerenderer::run(const std::shared_ptr<State> &st) {
+        Worker worker{0, nullptr, nullptr};
+        {
+            std::lock_guard<std::mutex> lock(st->mtx);
+            if (!st->idle.empty()) {
+                worker = std::move(st->idle.back());
+                st->idle.pop_back();
+            }
+        }
+        while (true) {
+            Job job;
+            std::shared_ptr<const TileSource> source;
+            {
+                std::lock_guard<std::mutex> lock(st->mtx);
+                if (st->stopping || st->queued.empty()) {
+                    st->running -= 1;
+                    if (worker.plot) {
+                        st->idle.push_back(std::move(worker));
+                    }
+                    return;
+                }
+                job = std::move(st->queued.front());
+                st->queued.pop_front();
+                source = st->source;
+                st->active.push_back(job.index);
+            }
+            sk_sp<SkImage> image;
+            if (!job.imagePath.empty()) {
+                image = decodeImageTile(job.imagePath, source->width, source->height);
+            } else {
+                try {
+                    if (!worker.plot || !worker.files || !worker.files->sameFiles(*source)) {
+                        worker.plot.reset();  // close the files of the old plot before opening them again
+                        worker.files.reset();
+                        worker.plot = makePlot(*source);
+                        worker.files = source;
+                        worker.generation = source->generation;
+                    } else if (worker.generation != source->generation) {
+                        applySource(*worker.plot, *source);
+                        worker.generation = source->generation;
+                    }
+                    GwPlot &plot = *worker.plot;
+                    plot.regions = std::move(job.regions);
+                    plot.processed = false;
+                    plot.runDrawOnCanvas(plot.rasterCanvas);
+                    image = plot.rasterSurface->makeImageSnapshot();
+                } catch (const std::exception &) {
+                    // The tile is drawn by the interactive plot when it is shown, which reports the error
+                    worker.plot.reset();
+                }
+            }
+            {
+                std::lock_guard<std::mutex> lock(st->mtx);
+                st->active.erase(std::find(st->active.begin(), st->active.end(), job.index));
+                if (image && source == st->source) {
+                    st->finished.emplace_back(job.index, std::move(image));
+                }
+            }
+        }
+    }
+
+}
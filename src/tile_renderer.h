@@ -0,0 +1,153 @@
+//
+// Rendering of variant tiles away from the interactive plot
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "BS_thread_pool.h"
+#include "hts_funcs.h"
+#include "themes.h"
+#include "utils.h"
+
+#include "include/core/SkData.h"
+#include "include/core/SkImage.h"
+#include "include/core/SkRefCnt.h"
+
+
+namespace Manager {
+
+    class GwPlot;
+
+    // Rendered tiles of the variant track shown in tiled mode, keyed by record number. Tiles are kept up to
+    // maxBytes of pixels and dropped least recently used first, but never below the number set with
+    // keepAtLeast, so the pages around the view stay drawn. A dropped tile is kept as a PNG, compressed at the
+    // fastest zlib level, while those fit in maxEncodedBytes, and is decoded again when it is next drawn.
+    // clear() is called whenever something that changes how a tile looks changes, so generation tells
+    // apart tiles drawn before and after it
+    class TileCache {
+    public:
+        explicit TileCache(size_t maxBytes = size_t(512) << 20, size_t maxEncodedBytes = size_t(128) << 20);
+
+        bool contains(int index) const { return entries.find(index) != entries.end(); }
+        // nullptr if there is no tile. A hit becomes the most recent
+        sk_sp<SkImage> get(int index);
+        void insert(int index, sk_sp<SkImage> image);
+        void keepAtLeast(size_t n);
+        size_t size() const { return entries.size(); }
+        void clear();
+        uint64_t generation() const { return gen; }
+
+    private:
+        struct Entry {
+            sk_sp<SkImage> image;  // null while only encoded is held
+            sk_sp<SkData> encoded;
+            std::list<int>::iterator pos;  // in decodedOrder or encodedOrder
+        };
+        std::unordered_map<int, Entry> entries;
+        std::list<int> decodedOrder, encodedOrder;  // most recent first
+        size_t decodedBytes{0}, encodedBytes{0};
+        size_t maxBytes, maxEncodedBytes;
+        size_t minImages{1};
+        uint64_t gen{0};
+
+        void evict();
+    };
+
+    // Decodes an image file to about width x height. Formats that can be decoded at a reduced size, which
+    // includes PNG through sampling, are decoded at the smallest size that still covers the tile. Returns
+    // nullptr if the file cannot be read or decoded
+    sk_sp<SkImage> decodeImageTile(const std::string &path, int width, int height);
+
+    // What a worker plot is built from, copied from the interactive plot once per TileCache generation
+    struct TileSource {
+        struct Track {
+            std::string path;  // reopened by each worker
+            HGW::FType kind;
+            // Records already loaded by the interactive plot, so that workers do not parse the file again
+            std::shared_ptr<const HGW::GwTrack::SharedBlocks> shared;
+            std::shared_ptr<HGW::MappedTrackFile> mapped;
+            std::optional<HGW::GwTrack> copy;  // ROI and INTRON tracks have no file and are copied instead
+            std::string name;
+            SkPaint faceColour, shadedFaceColour;
+            double height_fraction;
+        };
+        uint64_t generation{0};
+        std::string reference;
+        std::vector<std::string> bamPaths, filters;
+        size_t nRegions{0};  // filters are parsed against the regions of the interactive plot
+        std::vector<Track> tracks;
+        std::unordered_map<std::string, std::vector<Ideo::Band>> ideogram;
+        uint64_t ideogramGeneration{0};
+        Themes::IniOptions opts;
+        int width{0}, height{0};  // size of one tile, monitorScale is scaled down to match
+        float monitorScale{1};
+        bool showUIOverlay{false};  // the space kept for the top menu is part of the tile layout
+        bool drawLocation{true};
+
+        static std::shared_ptr<const TileSource> from(GwPlot &plot, uint64_t generation);
+        // True if a worker plot built from other has the files this source needs open
+        bool sameFiles(const TileSource &other) const;
+    };
+
+    // Draws the tiles of the pages either side of the one shown on worker threads, so that flipping a page
+    // finds them in the TileCache. Each worker uses a GwPlot of its own, with its own file handles, built
+    // from a TileSource. It is rebuilt only when the files of the source change, and otherwise takes the
+    // options and layout of each new generation. Tiles of --images are
+    // decoded from their files instead. Tiles that are finished are moved into the cache on the main
+    // thread with collect, so the cache itself is never shared
+    class TilePrerenderer {
+    public:
+        explicit TilePrerenderer(int nWorkers);
+        ~TilePrerenderer();
+
+        // Replaces the tiles waiting to be drawn. Tiles being drawn for an older source are dropped
+        void request(std::shared_ptr<const TileSource> source, std::vector<std::pair<int, std::vector<Utils::Region>>> tiles);
+        void requestImages(std::shared_ptr<const TileSource> source, std::vector<std::pair<int, std::string>> images);
+        // Adds finished tiles of generation to cache, returns the number added
+        size_t collect(TileCache &cache, uint64_t generation);
+
+    private:
+        struct Job {
+            int index;
+            std::vector<Utils::Region> regions;
+            std::string imagePath;  // set for a tile of --images
+        };
+        struct Worker {
+            uint64_t generation;
+            std::unique_ptr<GwPlot> plot;
+            std::shared_ptr<const TileSource> files;  // source the plot opened its files for
+        };
+        struct State {
+            std::mutex mtx;
+            std::shared_ptr<const TileSource> source;
+            std::deque<Job> queued;
+            std::vector<int> active;
+            std::vector<std::pair<int, sk_sp<SkImage>>> finished;
+            std::vector<Worker> idle;  // plots not used by a running task
+            int running{0};
+            bool stopping{false};
+            ~State();
+        };
+        int nWorkers;
+        std::shared_ptr<State> state;  // shared with running tasks
+        BS::thread_pool pool;
+
+        void enqueue(std::shared_ptr<const TileSource> source, std::vector<Job> jobs);
+        static void run(const std::shared_ptr<State> &state);
+        static std::unique_ptr<GwPlot> makePlot(const TileSource &source);
+        static void applySource(GwPlot &plot, const TileSource &source);
+    };
+
+}
@@ -0,0 +1,699 @@
+#include "track_cache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+
+#if defined(_WIN32)
+// Windows.h is pulled in by utils.h
+#elif !defined(__EMSCRIPTEN__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+    constexpr char cacheMagic[8] = {'G', 'W', 'T', 'R', 'K', 'C', '\0', '\0'};
+    constexpr uint32_t cacheVersion = 1;
+    constexpr uint32_t cacheByteOrder = 0x01020304;
+
+    // Small files parse faster than the sidecar is worth, and would litter data directories
+    constexpr uint64_t minSourceSizeToCache = 16 * 1024 * 1024;
+
+    // Total size of the indexed VCF copies kept in the user cache directory
+    constexpr uint64_t maxIndexedVcfCopyBytes = 4ULL * 1024 * 1024 * 1024;
+
+    struct CacheHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrder;
+        uint32_t kind;
+        uint32_t nChroms;
+        uint64_t sourceSize;
+        int64_t sourceMtime;
+        uint64_t rulesOff, rulesLen;
+        uint64_t chromsOff, recordsOff, nRecords;
+        uint64_t poolOff, poolSize;
+    };
+
+    struct CacheStr {
+        uint64_t off;
+        uint64_t len;
+    };
+
+    struct CacheChrom {
+        CacheStr name;
+        uint64_t first, count;
+    };
+
+    struct CacheRecord {
+        int32_t start, end;
+        int32_t strand, pad;
+        CacheStr name, line, vartype, parent, uniqueId;
+    };
+
+    bool sourceStat(const std::string &path, uint64_t &size, int64_t &mtime) {
+        std::error_code ec;
+        auto sz = std::filesystem::file_size(path, ec);
+        if (ec) {
+            return false;
+        }
+        auto t = std::filesystem::last_write_time(path, ec);
+        if (ec) {
+            return false;
+        }
+        size = (uint64_t)sz;
+        mtime = (int64_t)t.time_since_epoch().count();
+        return true;
+    }
+
+    bool cacheable(const std::string &path) {
+#if defined(__EMSCRIPTEN__)
+        return false;
+#else
+        return !(Utils::startsWith(path, "http") || Utils::startsWith(path, "ftp"));
+#endif
+    }
+
+    // $XDG_CACHE_HOME/gw, ~/.cache/gw or %LOCALAPPDATA%/gw/cache, empty if there is no home
+    std::filesystem::path userCacheDir() {
+#if defined(__EMSCRIPTEN__)
+        return {};
+#elif defined(_WIN32)
+        const char *local = std::getenv("LOCALAPPDATA");
+        return (local && *local) ? std::filesystem::path(local) / "gw" / "cache" : std::filesystem::path();
+#else
+        const char *xdg = std::getenv("XDG_CACHE_HOME");
+        if (xdg && *xdg) {
+            return std::filesystem::path(xdg) / "gw";
+        }
+        const char *home = std::getenv("HOME");
+        return (home && *home) ? std::filesystem::path(home) / ".cache" / "gw" : std::filesystem::path();
+#endif
+    }
+
+    // FNV-1a, so cached file names do not change between builds the way std::hash may
+    uint64_t pathHash(std::string_view s) {
+        uint64_t h = 14695981039346656037ULL;
+        for (unsigned char c : s) {
+            h ^= c;
+            h *= 1099511628211ULL;
+        }
+        return h;
+    }
+
+    // Appends strings to the pool section of the output stream. Short fields repeat
+    // heavily (feature types, gene names shared by many exons), so they are interned
+    class PoolWriter {
+    public:
+        PoolWriter(std::ofstream &out, uint64_t start) : pos(start), out(out) {}
+
+        CacheStr add(std::string_view s, bool intern) {
+            if (s.empty()) {
+                return {0, 0};
+            }
+            if (intern) {
+                auto it = seen.find(s);
+                if (it != seen.end()) {
+                    return it->second;
+                }
+            }
+            CacheStr ref{pos, s.size()};
+            out.write(s.data(), (std::streamsize)s.size());
+            pos += s.size();
+            if (intern) {
+                seen[s] = ref;
+            }
+            return ref;
+        }
+        uint64_t alignTo8() {
+            static const char zeros[8] = {0};
+            uint64_t extra = (8 - (pos % 8)) % 8;
+            out.write(zeros, (std::streamsize)extra);
+            pos += extra;
+            return pos;
+        }
+        uint64_t pos;
+    private:
+        std::ofstream &out;
+        ankerl::unordered_dense::map<std::string_view, CacheStr> seen;  // views into the store, unchanged while writing
+    };
+
+    constexpr char namesMagic[8] = {'G', 'W', 'N', 'A', 'M', 'E', 'S', '\0'};
+    constexpr uint32_t namesVersion = 2;  // 2: distant loci of one name are kept apart
+
+    // Scanning a small compressed file on the first search is quick enough without a sidecar
+    constexpr uint64_t minSourceSizeToSaveNames = 4 * 1024 * 1024;
+
+    struct NamesHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrder;
+        uint32_t kind;
+        uint32_t nChroms;
+        uint64_t sourceSize;
+        int64_t sourceMtime;
+        uint64_t rulesLen, chromsLen, nEntries, poolSize;
+    };
+
+    // Out of range references (a truncated or corrupt sidecar) read as empty strings
+    inline std::string_view poolView(const char *base, const CacheHeader *h, const CacheStr &s) {
+        if (s.off > h->poolSize || s.len > h->poolSize - s.off) {
+            return {};
+        }
+        return {base + h->poolOff + s.off, (size_t)s.len};
+    }
+
+}
+
+namespace HGW {
+
+    std::string indexedVcfCopyPath(const std::string &sourcePath) {
+        uint64_t sourceSize;
+        int64_t sourceMtime;
+        if (!cacheable(sourcePath) || !sourceStat(sourcePath, sourceSize, sourceMtime) ||
+            sourceSize < minSourceSizeToCache) {
+            return {};
+        }
+        const std::filesystem::path dir = userCacheDir();
+        std::error_code ec;
+        const std::filesystem::path abs = std::filesystem::absolute(sourcePath, ec);
+        if (dir.empty() || ec) {
+            return {};
+        }
+        char hash[17];
+        std::snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)pathHash(abs.string()));
+        return (dir / (std::string(hash) + "_" + abs.filename().string() + ".gz")).string();
+    }
+
+    void touchIndexedVcfCopy(const std::string &copyPath) {
+        std::error_code ec;
+        std::filesystem::last_write_time(copyPath, std::filesystem::file_time_type::clock::now(), ec);
+    }
+
+    void trimIndexedVcfCopies(const std::string &keepPath) {
+        const std::filesystem::path dir = userCacheDir();
+        std::error_code ec;
+        if (dir.empty() || !std::filesystem::is_directory(dir, ec)) {
+            return;
+        }
+        struct Copy {
+            std::filesystem::path path;
+            std::filesystem::file_time_type used;
+            uint64_t bytes;
+        };
+        std::vector<Copy> copies;
+        uint64_t total = 0;
+        for (const auto &entry : std::filesystem::directory_iterator(dir, ec)) {
+            const std::string fn = entry.path().filename().string();
+            // Only files named by indexedVcfCopyPath, "<16 hex digits>_<source name>.gz"
+            if (fn.size() < 20 || fn[16] != '_' || fn.compare(fn.size() - 3, 3, ".gz") != 0 ||
+                fn.find_first_not_of("0123456789abcdef") < 16 || !entry.is_regular_file(ec)) {
+                continue;
+            }
+            Copy c{entry.path(), entry.last_write_time(ec), entry.file_size(ec)};
+            if (ec) {
+                continue;
+            }
+            const uint64_t csi = std::filesystem::file_size(c.path.string() + ".csi", ec);
+            if (!ec) {
+                c.bytes += csi;
+            }
+            total += c.bytes;
+            copies.push_back(std::move(c));
+        }
+        std::sort(copies.begin(), copies.end(), [](const Copy &a, const Copy &b) { return a.used < b.used; });
+        const std::filesystem::path keep(keepPath);
+        for (const auto &c : copies) {
+            if (total <= maxIndexedVcfCopyBytes) {
+                break;
+            }
+            if (c.path == keep) {
+                continue;
+            }
+            std::filesystem::remove(c.path.string() + ".csi", ec);
+            std::filesystem::remove(c.path, ec);
+            total -= c.bytes;
+        }
+    }
+
+    std::string indexedVcfCopyKey(const std::string &sourcePath) {
+        uint64_t sourceSize;
+        int64_t sourceMtime;
+        std::error_code ec;
+        const std::filesystem::path abs = std::filesystem::absolute(sourcePath, ec);
+        if (ec || !sourceStat(sourcePath, sourceSize, sourceMtime)) {
+            return {};
+        }
+        return std::to_string(sourceSize) + ":" + std::to_string(sourceMtime) + ":" + abs.string();
+    }
+
+    std::string MappedTrackFile::sidecarPath(const std::string &sourcePath) {
+        return sourcePath + ".gwc";
+    }
+
+    MappedTrackFile::~MappedTrackFile() {
+#if defined(_WIN32)
+        if (base) {
+            UnmapViewOfFile(base);
+        }
+        if (mappingHandle) {
+            CloseHandle((HANDLE)mappingHandle);
+        }
+        if (fileHandle) {
+            CloseHandle((HANDLE)fileHandle);
+        }
+#elif !defined(__EMSCRIPTEN__)
+        if (base) {
+            munmap((void *)base, mappedSize);
+        }
+#endif
+    }
+
+    bool MappedTrackFile::map(const std::string &filePath) {
+#if defined(_WIN32)
+        HANDLE fh = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (fh == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        fileHandle = fh;
+        LARGE_INTEGER sz;
+        if (!GetFileSizeEx(fh, &sz) || sz.QuadPart == 0) {
+            return false;
+        }
+        HANDLE mh = CreateFileMappingA(fh, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mh) {
+            return false;
+        }
+        mappingHandle = mh;
+        base = (const char *)MapViewOfFile(mh, FILE_MAP_READ, 0, 0, 0);
+        mappedSize = (size_t)sz.QuadPart;
+        return base != nullptr;
+#elif !defined(__EMSCRIPTEN__)
+        int fd = ::open(filePath.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st{};
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            ::close(fd);
+            return false;
+        }
+        void *p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) {
+            return false;
+        }
+        base = (const char *)p;
+        mappedSize = (size_t)st.st_size;
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    std::shared_ptr<MappedTrackFile> MappedTrackFile::open(const std::string &sourcePath, int kind,
+                                                           const std::string &labelRules) {
+        uint64_t sourceSize;
+        int64_t sourceMtime;
+        if (!cacheable(sourcePath) || !sourceStat(sourcePath, sourceSize, sourceMtime)) {
+            return nullptr;
+        }
+        std::string cachePath = sidecarPath(sourcePath);
+        std::error_code ec;
+        if (!std::filesystem::exists(cachePath, ec)) {
+            return nullptr;
+        }
+        auto m = std::make_shared<MappedTrackFile>();
+        if (!m->map(cachePath) || m->mappedSize < sizeof(CacheHeader)) {
+            return nullptr;
+        }
+        const auto *h = (const CacheHeader *)m->base;
+        if (std::memcmp(h->magic, cacheMagic, sizeof(cacheMagic)) != 0 || h->version != cacheVersion ||
+            h->byteOrder != cacheByteOrder || h->kind != (uint32_t)kind ||
+            h->sourceSize != sourceSize || h->sourceMtime != sourceMtime) {
+            return nullptr;
+        }
+        // Bounds check every section before trusting any offsets inside them
+        const uint64_t fileSize = m->mappedSize;
+        if (h->poolOff > fileSize || h->poolSize > fileSize - h->poolOff ||
+            h->chromsOff > fileSize || (uint64_t)h->nChroms * sizeof(CacheChrom) > fileSize - h->chromsOff ||
+            h->recordsOff > fileSize || h->nRecords > (fileSize - h->recordsOff) / sizeof(CacheRecord) ||
+            h->rulesOff > h->poolSize || h->rulesLen > h->poolSize - h->rulesOff) {
+            return nullptr;
+        }
+        if (poolView(m->base, h, {h->rulesOff, h->rulesLen}) != labelRules) {
+            return nullptr;
+        }
+        const auto *chroms = (const CacheChrom *)(m->base + h->chromsOff);
+        for (uint32_t i = 0; i < h->nChroms; ++i) {
+            const CacheChrom &c = chroms[i];
+            if (c.first > h->nRecords || c.count > h->nRecords - c.first ||
+                c.name.off > h->poolSize || c.name.len > h->poolSize - c.name.off) {
+                return nullptr;
+            }
+            m->chromIndex[std::string(poolView(m->base, h, c.name))] = i;
+        }
+        return m;
+    }
+
+    void MappedTrackFile::write(const std::string &sourcePath, int kind, const std::string &labelRules,
+                                const ankerl::unordered_dense::map<std::string, SuperIntervals<int, FeatureRecord>> &blocks,
+                                const FeatureStore &store) {
+        uint64_t sourceSize;
+        int64_t sourceMtime;
+        if (!cacheable(sourcePath) || !sourceStat(sourcePath, sourceSize, sourceMtime) ||
+            sourceSize < minSourceSizeToCache) {
+            return;
+        }
+        // Written under a temporary name then renamed, so a concurrent reader never maps a partial file
+        const std::string cachePath = sidecarPath(sourcePath);
+        const std::string tmpPath = cachePath + ".tmp";
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            return;
+        }
+        CacheHeader h{};
+        std::memcpy(h.magic, cacheMagic, sizeof(cacheMagic));
+        h.version = cacheVersion;
+        h.byteOrder = cacheByteOrder;
+        h.kind = (uint32_t)kind;
+        h.nChroms = (uint32_t)blocks.size();
+        h.sourceSize = sourceSize;
+        h.sourceMtime = sourceMtime;
+        out.write((const char *)&h, sizeof(h));
+
+        h.poolOff = sizeof(CacheHeader);
+        PoolWriter pool(out, 0);
+        const CacheStr rules = pool.add(labelRules, false);
+        h.rulesOff = rules.off;
+        h.rulesLen = rules.len;
+
+        std::vector<CacheChrom> chroms;
+        std::vector<CacheRecord> records;
+        chroms.reserve(blocks.size());
+        for (const auto &item : blocks) {
+            CacheChrom c{};
+            c.name = pool.add(item.first, true);
+            c.first = records.size();
+            for (const auto &b : item.second.data) {
+                CacheRecord r{};
+                r.start = b.start;
+                r.end = b.end;
+                r.strand = b.strand;
+                r.name = pool.add(store.text(b.name), true);
+                r.line = pool.add(store.text(b.line), false);
+                r.vartype = pool.add(store.str(b.vartype), true);
+                r.parent = pool.add(store.str(b.parent), true);
+                r.uniqueId = pool.add(store.text(b.uniqueId), true);
+                records.push_back(r);
+            }
+            c.count = records.size() - c.first;
+            chroms.push_back(c);
+        }
+        h.poolSize = pool.alignTo8();
+        h.chromsOff = h.poolOff + h.poolSize;
+        out.write((const char *)chroms.data(), (std::streamsize)(chroms.size() * sizeof(CacheChrom)));
+        h.recordsOff = h.chromsOff + chroms.size() * sizeof(CacheChrom);
+        h.nRecords = records.size();
+        out.write((const char *)records.data(), (std::streamsize)(records.size() * sizeof(CacheRecord)));
+        out.seekp(0);
+        out.write((const char *)&h, sizeof(h));
+        out.close();
+        std::error_code ec;
+        if (!out) {
+            std::filesystem::remove(tmpPath, ec);
+            return;
+        }
+        std::filesystem::rename(tmpPath, cachePath, ec);
+        if (ec) {
+            std::filesystem::remove(tmpPath, ec);
+        }
+    }
+
+    void MappedTrackFile::attach(FeatureStore &store) const {
+        const auto *h = (const CacheHeader *)base;
+        store.setMapped(shared_from_this(), base + h->poolOff, h->poolSize);
+    }
+
+    void MappedTrackFile::load(const std::string &chrom, SuperIntervals<int, FeatureRecord> &out, FeatureStore &store) const {
+        auto it = chromIndex.find(chrom);
+        if (it == chromIndex.end()) {
+            return;
+        }
+        const auto *h = (const CacheHeader *)base;
+        const auto &c = ((const CacheChrom *)(base + h->chromsOff))[it->second];
+        const auto *records = (const CacheRecord *)(base + h->recordsOff) + c.first;
+        out.reserve(out.size() + c.count);
+        const uint32_t chromId = store.intern(chrom);
+        for (uint64_t i = 0; i < c.count; ++i) {
+            const CacheRecord &r = records[i];
+            FeatureRecord f{};
+            f.start = r.start;
+            f.end = r.end;
+            f.strand = r.strand;
+            f.chrom = chromId;
+            f.vartype = store.intern(poolView(base, h, r.vartype));
+            f.parent = store.intern(poolView(base, h, r.parent));
+            f.line = store.mappedText(r.line.off, r.line.len);
+            f.name = store.mappedText(r.name.off, r.name.len);
+            f.uniqueId = store.mappedText(r.uniqueId.off, r.uniqueId.len);
+            out.add(f.start, f.end, f);
+        }
+        out.index();
+    }
+
+    void MappedTrackFile::addNames(FeatureNameIndex &index, bool withParents) const {
+        const auto *h = (const CacheHeader *)base;
+        const auto *chroms = (const CacheChrom *)(base + h->chromsOff);
+        const auto *records = (const CacheRecord *)(base + h->recordsOff);
+        for (uint32_t ci = 0; ci < h->nChroms; ++ci) {
+            const CacheChrom &c = chroms[ci];
+            const std::string_view chrom = poolView(base, h, c.name);
+            for (uint64_t i = 0; i < c.count; ++i) {
+                const CacheRecord &r = records[c.first + i];
+                index.add(poolView(base, h, r.name), chrom, r.start, r.end);
+                index.add(poolView(base, h, r.uniqueId), chrom, r.start, r.end);
+                if (withParents) {
+                    index.add(poolView(base, h, r.parent), chrom, r.start, r.end);
+                }
+            }
+        }
+    }
+
+    void FeatureNameIndex::add(std::string_view name, std::string_view chrom, int start, int end) {
+        if (name.empty() || name == ".") {
+            return;
+        }
+        // Records come grouped by chromosome, so the map is only searched when it changes
+        if (chroms.empty() || chroms[lastChrom] != chrom) {
+            auto it = chromIds.find(std::string(chrom));
+            if (it == chromIds.end()) {
+                lastChrom = (uint32_t)chroms.size();
+                chroms.emplace_back(chrom);
+                chromIds[chroms.back()] = lastChrom;
+            } else {
+                lastChrom = it->second;
+            }
+        }
+        entries.push_back({pool.size(), (uint32_t)name.size(), lastChrom, start, end});
+        pool.append(name);
+    }
+
+    // Longest intron-scale gap between records of one name that are still merged into one locus
+    constexpr int64_t maxNameGap = 2'500'000;
+
+    void FeatureNameIndex::finish() {
+        // Stable, so names found at several loci keep file order and the first one wins
+        std::stable_sort(entries.begin(), entries.end(), [&](const Entry &a, const Entry &b) {
+            return std::string_view(pool.data() + a.nameOff, a.nameLen) < std::string_view(pool.data() + b.nameOff, b.nameLen);
+        });
+        std::string merged;
+        std::vector<Entry> out;
+        std::vector<size_t> order;  // entries of one name by position
+        std::vector<std::pair<size_t, Entry>> loci;  // first entry in file order, merged span
+        size_t i = 0;
+        while (i < entries.size()) {
+            const std::string_view nm(pool.data() + entries[i].nameOff, entries[i].nameLen);
+            const uint64_t off = merged.size();
+            merged.append(nm);
+            const size_t groupStart = i;
+            while (i < entries.size() && std::string_view(pool.data() + entries[i].nameOff, entries[i].nameLen) == nm) {
+                ++i;
+            }
+            order.resize(i - groupStart);
+            for (size_t k = 0; k < order.size(); ++k) {
+                order[k] = groupStart + k;
+            }
+            std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+                return (entries[a].chrom != entries[b].chrom) ? entries[a].chrom < entries[b].chrom : entries[a].start < entries[b].start;
+            });
+            // Parts of one feature, e.g. exons, lie within a gene length of each other. Further apart
+            // the same name is a separate locus, e.g. a repeat family or a gene copy
+            loci.clear();
+            for (size_t k : order) {
+                const Entry &e = entries[k];
+                if (!loci.empty() && loci.back().second.chrom == e.chrom &&
+                    (int64_t)e.start <= (int64_t)loci.back().second.end + maxNameGap) {
+                    Entry &locus = loci.back().second;
+                    locus.end = std::max(locus.end, e.end);
+                    loci.back().first = std::min(loci.back().first, k);
+                } else {
+                    loci.push_back({k, {off, e.nameLen, e.chrom, e.start, e.end}});
+                }
+            }
+            std::sort(loci.begin(), loci.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+            for (const auto &locus : loci) {
+                out.push_back(locus.second);
+            }
+        }
+        pool = std::move(merged);
+        entries = std::move(out);
+        pool.shrink_to_fit();
+        entries.shrink_to_fit();
+    }
+
+    void FeatureNameIndex::setRegion(const Entry &e, Utils::Region &region) const {
+        region.chrom = chroms[e.chrom];
+        region.start = e.start;
+        region.end = e.end;
+        region.markers = {{e.start, e.end}};
+    }
+
+    bool FeatureNameIndex::find(std::string_view key, Utils::Region &region) const {
+        auto it = std::lower_bound(entries.begin(), entries.end(), key, [&](const Entry &e, std::string_view k) {
+            return std::string_view(pool.data() + e.nameOff, e.nameLen) < k;
+        });
+        if (it == entries.end() || std::string_view(pool.data() + it->nameOff, it->nameLen) != key) {
+            return false;
+        }
+        setRegion(*it, region);
+        return true;
+    }
+
+    bool FeatureNameIndex::findContaining(std::string_view part, Utils::Region &region) const {
+        for (const auto &e : entries) {
+            if (std::string_view(pool.data() + e.nameOff, e.nameLen).find(part) != std::string_view::npos) {
+                setRegion(e, region);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::shared_ptr<FeatureNameIndex> FeatureNameIndex::load(const std::string &sourcePath, int kind, const std::string &labelRules) {
+        uint64_t sourceSize;
+        int64_t sourceMtime;
+        if (!cacheable(sourcePath) || !sourceStat(sourcePath, sourceSize, sourceMtime)) {
+            return nullptr;
+        }
+        std::ifstream in(sourcePath + ".gwn", std::ios::binary);
+        if (!in) {
+            return nullptr;
+        }
+        NamesHeader h{};
+        if (!in.read((char *)&h, sizeof(h)) || std::memcmp(h.magic, namesMagic, sizeof(namesMagic)) != 0 ||
+            h.version != namesVersion || h.byteOrder != cacheByteOrder || h.kind != (uint32_t)kind ||
+            h.sourceSize != sourceSize || h.sourceMtime != sourceMtime) {
+            return nullptr;
+        }
+        std::error_code ec;
+        const uint64_t fileSize = std::filesystem::file_size(sourcePath + ".gwn", ec);
+        if (ec || h.rulesLen > fileSize || h.chromsLen > fileSize || h.poolSize > fileSize ||
+            h.nEntries > fileSize / sizeof(Entry) ||
+            sizeof(h) + h.rulesLen + h.chromsLen + h.nEntries * sizeof(Entry) + h.poolSize != fileSize) {
+            return nullptr;
+        }
+        std::string rules(h.rulesLen, '\0');
+        std::string chromBytes(h.chromsLen, '\0');
+        in.read(rules.data(), (std::streamsize)h.rulesLen);
+        in.read(chromBytes.data(), (std::streamsize)h.chromsLen);
+        if (!in || rules != labelRules) {
+            return nullptr;
+        }
+        auto idx = std::make_shared<FeatureNameIndex>();
+        idx->entries.resize(h.nEntries);
+        idx->pool.resize(h.poolSize);
+        in.read((char *)idx->entries.data(), (std::streamsize)(h.nEntries * sizeof(Entry)));
+        in.read(idx->pool.data(), (std::streamsize)h.poolSize);
+        if (!in) {
+            return nullptr;
+        }
+        // Chrom names are stored NUL terminated, one after another
+        size_t pos = 0;
+        while (pos < chromBytes.size()) {
+            const size_t stop = chromBytes.find('\0', pos);
+            if (stop == std::string::npos) {
+                return nullptr;
+            }
+            idx->chromIds[chromBytes.substr(pos, stop - pos)] = (uint32_t)idx->chroms.size();
+            idx->chroms.push_back(chromBytes.substr(pos, stop - pos));
+            pos = stop + 1;
+        }
+        if (idx->chroms.size() != h.nChroms) {
+            return nullptr;
+        }
+        for (const auto &e : idx->entries) {
+            if (e.chrom >= h.nChroms || e.nameOff > h.poolSize || e.nameLen > h.poolSize - e.nameOff) {
+                return nullptr;
+            }
+        }
+        return idx;
+    }
+
+    void FeatureNameIndex::save(const std::string &sourcePath, int kind, const std::string &labelRules) const {
+        uint64_t sourceSize;
+        int64_t sourceMtime;
+        if (!cacheable(sourcePath) || !sourceStat(sourcePath, sourceSize, sourceMtime) ||
+            sourceSize < minSourceSizeToSaveNames) {
+            return;
+        }
+        std::string chromBytes;
+        for (const auto &c : chroms) {
+            chromBytes += c;
+            chromBytes += '\0';
+        }
+        NamesHeader h{};
+        std::memcpy(h.magic, namesMagic, sizeof(namesMagic));
+        h.version = namesVersion;
+        h.byteOrder = cacheByteOrder;
+        h.kind = (uint32_t)kind;
+        h.nChroms = (uint32_t)chroms.size();
+        h.sourceSize = sourceSize;
+        h.sourceMtime = sourceMtime;
+        h.rulesLen = labelRules.size();
+        h.chromsLen = chromBytes.size();
+        h.nEntries = entries.size();
+        h.poolSize = pool.size();
+
+        const std::string namesPath = sourcePath + ".gwn";
+        const std::string tmpPath = namesPath + ".tmp";
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            return;
+        }
+        out.write((const char *)&h, sizeof(h));
+        out.write(labelRules.data(), (std::streamsize)labelRules.size());
+        out.write(chromBytes.data(), (std::streamsize)chromBytes.size());
+        out.write((const char *)entries.data(), (std::streamsize)(entries.size() * sizeof(Entry)));
+        out.write(pool.data(), (std::streamsize)pool.size());
+        out.close();
+        std::error_code ec;
+        if (!out) {
+            std::filesystem::remove(tmpPath, ec);
+            return;
+        }
+        std::filesystem::rename(tmpPath, namesPath, ec);
+        if (ec) {
+            std::filesystem::remove(tmpPath, ec);
+        }
+    }
+
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ankerl_unordered_dense.h"
+#include "feature_store.h"
+#include "superintervals.hpp"
+#include "utils.h"
+
+namespace HGW {
+
+    // Name to locus lookup for goto/search, covering BED names, VCF ids and GFF/GTF gene and
+    // transcript names. Names are kept sorted in one string pool, so an exact lookup is a binary
+    // search. Repeated names on a chromosome that overlap or lie within a gene length of each other
+    // (e.g. the exons of a gene) are merged into one locus spanning them. Loci further apart are kept
+    // apart, and a lookup finds the first in file order. For indexed tracks, which need a full scan
+    // to build, the index is persisted as "<path>.gwn" under the same validity rules as MappedTrackFile
+    class FeatureNameIndex {
+    public:
+        void add(std::string_view name, std::string_view chrom, int start, int end);
+        // Sorts and merges what was added, must be called before lookups
+        void finish();
+
+        bool find(std::string_view name, Utils::Region &region) const;
+        // First name, in sorted order, that contains part
+        bool findContaining(std::string_view part, Utils::Region &region) const;
+
+        size_t size() const { return entries.size(); }
+        std::string_view name(size_t i) const { return {pool.data() + entries[i].nameOff, entries[i].nameLen}; }
+
+        static std::shared_ptr<FeatureNameIndex> load(const std::string &sourcePath, int kind, const std::string &labelRules);
+        void save(const std::string &sourcePath, int kind, const std::string &labelRules) const;
+
+    private:
+        struct Entry {
+            uint64_t nameOff;
+            uint32_t nameLen;
+            uint32_t chrom;
+            int32_t start, end;
+        };
+        std::string pool;
+        std::vector<Entry> entries;
+        std::vector<std::string> chroms;
+        ankerl::unordered_dense::map<std::string, uint32_t> chromIds;
+        uint32_t lastChrom{0};
+
+        void setRegion(const Entry &e, Utils::Region &region) const;
+    };
+
+    // Binary sidecar for non-indexed BED/GFF3/GTF/PAF/label tracks, written next
+    // to the source as "<path>.gwc" after the first full parse. The file holds a
+    // chrom table, a position-sorted record array per chrom and a string pool.
+    // Later loads mmap the sidecar and only build a chromosome's FeatureRecords
+    // when it is first fetched, so opening a large annotation file costs a stat
+    // and a map rather than a full parse. Strings stay in the mapped pool.
+    //
+    // A sidecar is valid only if the source size, mtime, track kind and label
+    // rules all match what was recorded; anything else is treated as a miss.
+    class MappedTrackFile : public std::enable_shared_from_this<MappedTrackFile> {
+    public:
+        MappedTrackFile() = default;
+        ~MappedTrackFile();
+        MappedTrackFile(const MappedTrackFile&) = delete;
+        MappedTrackFile& operator=(const MappedTrackFile&) = delete;
+
+        // Returns nullptr when there is no valid sidecar for this source
+        static std::shared_ptr<MappedTrackFile> open(const std::string &sourcePath, int kind,
+                                                     const std::string &labelRules);
+
+        // Serialises already indexed blocks. Failure (e.g. read-only directory) is silent
+        static void write(const std::string &sourcePath, int kind, const std::string &labelRules,
+                          const ankerl::unordered_dense::map<std::string, SuperIntervals<int, FeatureRecord>> &blocks,
+                          const FeatureStore &store);
+
+        static std::string sidecarPath(const std::string &sourcePath);
+
+        bool contains(const std::string &chrom) const { return chromIndex.contains(chrom); }
+
+        // Points store at the mapped string pool. Must be called before load
+        void attach(FeatureStore &store) const;
+
+        // Adds every record of chrom to out and indexes it
+        void load(const std::string &chrom, SuperIntervals<int, FeatureRecord> &out, FeatureStore &store) const;
+
+        // Adds the name and id of every record, and the parent if withParents, without loading any chromosome
+        void addNames(FeatureNameIndex &index, bool withParents) const;
+
+    private:
+        const char *base{nullptr};
+        size_t mappedSize{0};
+#if defined(_WIN32)
+        void *fileHandle{nullptr};
+        void *mappingHandle{nullptr};
+#endif
+        ankerl::unordered_dense::map<std::string, uint32_t> chromIndex;
+
+        bool map(const std::string &filePath);
+    };
+
+    // Plain VCF tracks as large as a .gwc sidecar source are copied, while they are first read, to a
+    // BGZF compressed and CSI indexed file in the user cache directory, so later sessions fetch them
+    // by region like a .vcf.gz. The copy records indexedVcfCopyKey of its source in a "##gwSource"
+    // header line and is replaced once the source changes. The path is empty when no copy should be kept.
+    // Copies go to $XDG_CACHE_HOME/gw or ~/.cache/gw (%LOCALAPPDATA%\gw\cache on Windows) and may be
+    // deleted at any time; they are rewritten on the next read of their source
+    std::string indexedVcfCopyPath(const std::string &sourcePath);
+    std::string indexedVcfCopyKey(const std::string &sourcePath);
+    // Marks a copy as used, so that trimIndexedVcfCopies removes it after copies that were not
+    void touchIndexedVcfCopy(const std::string &copyPath);
+    // Removes the least recently used copies, never keepPath, until they fit in maxIndexedVcfCopyBytes
+    void trimIndexedVcfCopies(const std::string &keepPath);
+
+    // Recently fetched windows of an indexed track, so that pans and small zooms inside a window
+    // that was already read are served without another index query or decompression. Windows are
+    // dropped least recently used first once their total size passes maxBytes. The few newest are
+    // always kept, so that split views of wide regions do not evict each other's windows.
+    // resolution tells apart windows of the same region read at different detail, e.g. bigWig zoom levels
+    template<typename T>
+    class WindowCache {
+    public:
+        struct Window {
+            std::string chrom;
+            int start, end;
+            int resolution;
+            size_t bytes;
+            T value;
+        };
+
+        explicit WindowCache(size_t maxBytes = 64 << 20) : maxBytes(maxBytes) {}
+
+        // Window holding all of [start, end) on chrom, or nullptr. A hit becomes the most recent
+        Window *find(const std::string &chrom, int start, int end, int resolution = 0) {
+            for (auto it = windows.begin(); it != windows.end(); ++it) {
+                if (it->chrom == chrom && it->start <= start && it->end >= end && it->resolution == resolution) {
+                    windows.splice(windows.begin(), windows, it);
+                    return &windows.front();
+                }
+            }
+            return nullptr;
+        }
+
+        Window &insert(const std::string &chrom, int start, int end, size_t bytes, T &&value, int resolution = 0) {
+            windows.push_front({chrom, start, end, resolution, bytes, std::move(value)});
+            totalBytes += bytes;
+            while (totalBytes > maxBytes && windows.size() > minWindows) {
+                totalBytes -= windows.back().bytes;
+                windows.pop_back();
+            }
+            return windows.front();
+        }
+
+        void clear() {
+            windows.clear();
+            totalBytes = 0;
+        }
+
+    private:
+        static constexpr size_t minWindows = 4;
+        std::list<Window> windows;  // most recent first, list so that returned windows stay put
+        size_t totalBytes{0};
+        size_t maxBytes;
+    };
+
+    // Decoded features of one window of a tabix or BCF track
+    struct FeatureWindow {
+        SuperIntervals<int, FeatureRecord> blocks;
+        std::shared_ptr<FeatureStore> store;
+    };
+
+}
@@ -2,6 +2,8 @@
 // Created by Kez Cleal on 25/07/2022.
 //
 #include <algorithm>
+#include <array>
+#include <charconv>
 #include <filesystem>
 #include <fstream>
 #include <iomanip>
@@ -174,6 +176,61 @@ namespace Utils {
         return elems;
     }
 
+    int splitView(std::string_view s, char delim, std::string_view *fields, int maxFields, bool skipEmpty) {
+        int n = 0;
+        size_t start = 0;
+        while (n < maxFields) {
+            size_t end = s.find(delim, start);
+            if (end == std::string_view::npos) {
+                end = s.size();
+            }
+            if (!skipEmpty || end > start) {
+                fields[n++] = s.substr(start, end - start);
+            }
+            if (end == s.size()) {
+                break;
+            }
+            start = end + 1;
+        }
+        return n;
+    }
+
+    void splitInto(std::string_view s, char delim, std::vector<std::string> &parts, bool skipEmpty) {
+        size_t n = 0;
+        size_t start = 0;
+        while (true) {
+            size_t end = s.find(delim, start);
+            if (end == std::string_view::npos) {
+                end = s.size();
+            }
+            if (!skipEmpty || end > start) {
+                if (n == parts.size()) {
+                    parts.emplace_back();
+                }
+                parts[n++].assign(s.data() + start, end - start);
+            }
+            if (end == s.size()) {
+                break;
+            }
+            start = end + 1;
+        }
+        parts.resize(n);
+    }
+
+    bool parseInt(std::string_view s, int &value) {
+        size_t i = 0;
+        while (i < s.size() && (s[i] == ' ' || s[i] == '\t')) {
+            ++i;
+        }
+        if (i < s.size() && s[i] == '+') {
+            ++i;
+        }
+        const char *first = s.data() + i;
+        const char *last = s.data() + s.size();
+        auto res = std::from_chars(first, last, value);
+        return res.ec == std::errc() && res.ptr != first;
+    }
+
     int atoi_wo_comma(std::string s) {
         int n = 0;
         for (char &c : s) {
@@ -615,6 +672,22 @@ namespace Utils {
         return a + b;
     }
 
+    void nibbleSequence(const char *seq, int len, std::vector<uint8_t> &out) {
+        static const std::array<uint8_t, 256> table = [] {
+            std::array<uint8_t, 256> t{};
+            t['A'] = 1; t['a'] = 1;
+            t['C'] = 2; t['c'] = 2;
+            t['G'] = 4; t['g'] = 4;
+            t['T'] = 8; t['t'] = 8;
+            t['N'] = 15; t['n'] = 15;
+            return t;
+        }();
+        out.resize((seq != nullptr && len > 0) ? len : 0);
+        for (size_t i = 0; i < out.size(); ++i) {
+            out[i] = table[(unsigned char)seq[i]];
+        }
+    }
+
     std::string formatNum(int num) {
         std::string s = std::to_string(num);
         int n = (int)s.size();
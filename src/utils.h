@@ -6,6 +6,7 @@
 
 #include <filesystem>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 #include "ankerl_unordered_dense.h"
@@ -48,6 +49,17 @@ namespace Utils {
 
     std::vector<std::string> split_keep_empty_str(const std::string &s, const char delim);
 
+    // Allocation free split for the text-track parsers. Writes at most maxFields views into fields,
+    // which point into s, and returns the count. skipEmpty drops empty fields as split() does
+    int splitView(std::string_view s, char delim, std::string_view *fields, int maxFields, bool skipEmpty);
+
+    // Like splitView, but copies into parts, reusing the capacity of the strings already there
+    void splitInto(std::string_view s, char delim, std::vector<std::string> &parts, bool skipEmpty);
+
+    // Integer field parse using from_chars. Leading spaces and '+' are accepted, as with std::stoi,
+    // but failure is reported by return value rather than an exception
+    bool parseInt(std::string_view s, int &value);
+
     // https://stackoverflow.com/questions/1528298/get-path-of-executable
     std::string getExecutableDir();
 
@@ -175,6 +187,9 @@ namespace Utils {
     std::string getSize(long num);
     std::string formatNum(int num);
 
+    // Bases as 4-bit codes matching bam_seqi (A=1, C=2, G=4, T=8, N=15, anything else 0)
+    void nibbleSequence(const char *seq, int len, std::vector<uint8_t> &out);
+
     void parseMateLocation(std::string &selectedAlign, std::string &mate, std::string &target_qname);
 
     int get_terminal_width();	